@@ -0,0 +1,183 @@
+#include <stdexcept>
+#include <utility>
+#include "log.h"
+#include "handshake.h"
+#include "async_reliable.h"
+
+ITimerService::TimerId AsyncReliable::Timers::schedule(Clock::time_point when, std::function<void()> callback) {
+    return owner.loop.schedule(when, [this, callback = std::move(callback)] {
+        callback();
+        owner.checkFinished();
+    });
+}
+
+void AsyncReliable::SessionAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    owner.session = &session;
+    owner.waiting = handle;
+    owner.loop.watch(owner.unreliable.socket(), [this] {
+        SessionHelper::deliver(owner.unreliable, session, owner.packets);
+        owner.checkFinished();
+    });
+
+    session.start();
+    owner.checkFinished();
+}
+
+void AsyncReliable::PacketAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    auto finish = [this, handle] {
+        owner.loop.unwatch(owner.unreliable.socket());
+        owner.loop.cancel(timer);
+        owner.resumeLater(handle);
+    };
+
+    // one at a time, what follows the handshake belongs to the transfer
+    owner.loop.watch(owner.unreliable.socket(), [this, finish] {
+        owner.packets.clear();
+        if (owner.unreliable.recv(owner.packets, Clock::duration::zero(), 1) > 0) {
+            packet = std::move(owner.packets[0]);
+            finish();
+        }
+    });
+    if (deadline != Clock::time_point::max()) {
+        timer = owner.loop.schedule(deadline, finish);
+    }
+}
+
+AsyncReliable::AsyncReliable(EventLoop &loop, Unreliable unreliable, Protocol protocol)
+        : loop(loop), unreliable(std::move(unreliable)), protocol(std::move(protocol)), timers(*this) {
+    this->unreliable.setStats(&counters);
+}
+
+void AsyncReliable::checkFinished() {
+    if (session == nullptr || !session->finished()) {
+        return;
+    }
+
+    loop.unwatch(unreliable.socket());
+    session = nullptr;
+    resumeLater(std::exchange(waiting, nullptr));
+}
+
+void AsyncReliable::resumeLater(std::coroutine_handle<> handle) {
+    loop.schedule(loop.now(), [handle] { handle.resume(); });
+}
+
+Task<bool> AsyncReliable::send(ISource &source) {
+    auto sender = protocol.sender(unreliable, timers, rtt, source);
+    co_return co_await run(*sender);
+}
+
+Task<bool> AsyncReliable::send(std::span<const uint8_t> data) {
+    MemorySource source(data.data(), data.size());
+    co_return co_await send(source);
+}
+
+Task<uint64_t> AsyncReliable::recv(ISink &sink) {
+    auto receiver = protocol.receiver(unreliable, timers, sink);
+    if (!co_await run(*receiver)) {
+        throw std::runtime_error("failed to receive");
+    }
+    co_return receiver->received();
+}
+
+Task<uint64_t> AsyncReliable::recv(std::span<uint8_t> buf) {
+    MemorySink sink(buf.data(), buf.size());
+    co_return co_await recv(sink);
+}
+
+ReliableStats AsyncReliable::stats() const {
+    return counters.snapshot(rtt);
+}
+
+Task<std::unique_ptr<AsyncReliable>> AsyncReliable::connect(EventLoop &loop, Protocol protocol,
+                                                            std::string ip, uint16_t port,
+                                                            uint32_t packetSize, bool probe) {
+    SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        LOG_ERROR << "socket() failed: " << lastSocketError() << std::endl;
+        throw std::runtime_error("socket() failed");
+    }
+
+    auto connection = std::make_unique<AsyncReliable>(loop, Unreliable(s, ip, port), std::move(protocol));
+    Unreliable &unreliable = connection->unreliable;
+    probe = probe && HandshakeHelper::setDontFragment(s, true);
+
+    auto attempts = HandshakeHelper::schedule(packetSize, probe);
+    for (const auto &attempt: attempts) {
+        // 1. send SYN, too large for the first hop it fails right here
+        if (!unreliable.send(HandshakeHelper::makeSyn(attempt.packetSize, probe))) {
+            if (probe) {
+                continue;
+            }
+            LOG_ERROR << "failed to send SYN to server" << std::endl;
+            throw std::runtime_error("failed to send SYN to server");
+        }
+        LOG_INFO << "sent SYN to server, packet size " << attempt.packetSize << std::endl;
+
+        // 2. recv SYN_ACK
+        auto deadline = loop.now() + attempt.timeout;
+        while (PacketPtr packet = co_await connection->nextPacket(deadline)) {
+            if (!PacketHelper::isValidPacket(packet) || packet->type != PacketType::SYN_ACK) {
+                continue;
+            }
+
+            uint32_t agreed = HandshakeHelper::agreed(*packet, attempts.front().packetSize);
+            if (agreed == 0) {
+                throw std::runtime_error("failed to agree on a packet size");
+            }
+            unreliable.setPacketSize(agreed);
+            if (probe) {
+                HandshakeHelper::setDontFragment(s, false);
+            }
+
+            LOG_INFO << "received SYN_ACK from server, packet size " << agreed << std::endl;
+            LOG_INFO << "connect established" << std::endl;
+            co_return connection;
+        }
+    }
+
+    LOG_ERROR << "failed to receive packet from server" << std::endl;
+    throw std::runtime_error("failed to receive packet from server");
+}
+
+Task<std::unique_ptr<AsyncReliable>> AsyncReliable::accept(EventLoop &loop, Protocol protocol, uint16_t port,
+                                                           uint32_t packetSize) {
+    SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        LOG_ERROR << "socket() failed: " << lastSocketError() << std::endl;
+        throw std::runtime_error("socket() failed");
+    }
+
+    sockaddr_in listenAddr{};
+    listenAddr.sin_family = AF_INET;
+    listenAddr.sin_port = htons(port);
+    listenAddr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(s, (sockaddr *) &listenAddr, sizeof(listenAddr)) == SOCKET_ERROR) {
+        LOG_ERROR << "bind() failed: " << lastSocketError() << std::endl;
+        closesocket(s);
+        throw std::runtime_error("bind() failed");
+    }
+
+    auto connection = std::make_unique<AsyncReliable>(loop, Unreliable(s), std::move(protocol));
+
+    // 1. recv SYN, the first sender becomes the peer
+    PacketPtr packet = co_await connection->nextPacket(Clock::time_point::max());
+    if (!PacketHelper::isValidPacket(packet) || packet->type != PacketType::SYN) {
+        LOG_ERROR << "failed to receive packet from client" << std::endl;
+        throw std::runtime_error("failed to receive packet from client");
+    }
+    LOG_INFO << "received SYN from client" << std::endl;
+
+    // 2. send SYN_ACK, with the packet size agreed to
+    Unreliable &unreliable = connection->unreliable;
+    unreliable.setPacketSize(HandshakeHelper::agree(*packet, packetSize));
+    if (!unreliable.send(PacketHelper::makePacket(PacketType::SYN_ACK, unreliable.packetSize()))) {
+        LOG_ERROR << "failed to send SYN_ACK to client" << std::endl;
+        throw std::runtime_error("failed to send SYN_ACK to client");
+    }
+    LOG_INFO << "sent SYN_ACK to client" << std::endl;
+
+    LOG_INFO << "connect established" << std::endl;
+    co_return connection;
+}
@@ -0,0 +1,173 @@
+#ifndef RELIABLE_OVER_UDP_ASYNC_RELIABLE_H
+#define RELIABLE_OVER_UDP_ASYNC_RELIABLE_H
+
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "unreliable.h"
+#include "rtt_estimator.h"
+#include "reliable_stats.h"
+#include "stream.h"
+#include "session.h"
+#include "event_loop.h"
+#include "task.h"
+#include "congestion.h"
+
+// a connection whose transfers are coroutines: co_await send / recv
+// suspends the caller instead of blocking its thread, the protocol runs
+// on the event loop meanwhile, so one thread can serve any number of
+// connections
+//
+// everything, the loop included, runs on the thread inside loop.run(),
+// a connection runs one transfer at a time and must outlive it
+class AsyncReliable {
+public:
+    // the protocol, see ReliableGBN::makeSender / makeReceiver
+    struct Protocol {
+        std::function<std::unique_ptr<ISession>(ITransport &, ITimerService &, RttEstimator &, ISource &)> sender;
+        std::function<std::unique_ptr<ReceiverSession>(ITransport &, ITimerService &, ISink &)> receiver;
+    };
+
+private:
+    using Clock = ITimerService::Clock;
+
+    // the loop, but every timer which fires is followed by a look at
+    // whether the transfer is over
+    class Timers : public ITimerService {
+        AsyncReliable &owner;
+    public:
+        explicit Timers(AsyncReliable &owner)
+                : owner(owner) {}
+
+        Clock::time_point now() const override {
+            return owner.loop.now();
+        }
+
+        TimerId schedule(Clock::time_point when, std::function<void()> callback) override;
+
+        void cancel(TimerId id) override {
+            owner.loop.cancel(id);
+        }
+    };
+
+    // suspends until session finishes
+    struct SessionAwaiter {
+        AsyncReliable &owner;
+        ISession &session;
+
+        bool await_ready() {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        bool await_resume() {
+            return session.succeeded();
+        }
+    };
+
+    // suspends until a packet arrives or deadline passes, nullptr then
+    struct PacketAwaiter {
+        AsyncReliable &owner;
+        Clock::time_point deadline;
+        PacketPtr packet;
+        ITimerService::TimerId timer = 0;
+
+        bool await_ready() {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        PacketPtr await_resume() {
+            return std::move(packet);
+        }
+    };
+
+    EventLoop &loop;
+    Unreliable unreliable;
+    RttEstimator rtt;
+    ConnectionStats counters;
+    Protocol protocol;
+    Timers timers;
+
+    // the transfer in flight, and who awaits it
+    ISession *session = nullptr;
+    std::coroutine_handle<> waiting;
+    std::vector<PacketPtr> packets;
+
+    // resume waiting once the transfer is over
+    void checkFinished();
+
+    // resume from the loop, never from inside the callback which found out
+    void resumeLater(std::coroutine_handle<> handle);
+
+    SessionAwaiter run(ISession &transfer) {
+        return {*this, transfer};
+    }
+
+    PacketAwaiter nextPacket(Clock::time_point deadline) {
+        return {*this, deadline, nullptr};
+    }
+
+public:
+    AsyncReliable(EventLoop &loop, Unreliable unreliable, Protocol protocol);
+
+    AsyncReliable(const AsyncReliable &) = delete;
+
+    AsyncReliable &operator=(const AsyncReliable &) = delete;
+
+    // stream every byte of source, false if the peer was given up
+    Task<bool> send(ISource &source);
+
+    Task<bool> send(std::span<const uint8_t> data);
+
+    // returns the number of bytes written to sink, throws if the
+    // transfer failed
+    Task<uint64_t> recv(ISink &sink);
+
+    Task<uint64_t> recv(std::span<uint8_t> buf);
+
+    ReliableStats stats() const;
+
+    // the handshake of ReliableHelper::connect, without blocking
+    static Task<std::unique_ptr<AsyncReliable>> connect(EventLoop &loop, Protocol protocol,
+                                                        std::string ip, uint16_t port,
+                                                        uint32_t packetSize = MAX_PACKET_SIZE,
+                                                        bool probe = false);
+
+    // the handshake of ReliableHelper::listen, without blocking
+    static Task<std::unique_ptr<AsyncReliable>> accept(EventLoop &loop, Protocol protocol, uint16_t port,
+                                                       uint32_t packetSize = MAX_PACKET_SIZE);
+};
+
+namespace AsyncHelper {
+
+    // senders run under congestion
+    template <typename Ty>
+    AsyncReliable::Protocol protocol(Congestion congestion = Ty::defaultCongestion) {
+        auto sender = [congestion](ITransport &transport, ITimerService &timers, RttEstimator &rtt,
+                                   ISource &source) {
+            return Ty::makeSender(transport, timers, rtt, source, congestion);
+        };
+        return {sender, &Ty::makeReceiver};
+    }
+
+    template <typename Ty>
+    Task<std::unique_ptr<AsyncReliable>> connect(EventLoop &loop, const std::string &ip, uint16_t port,
+                                                 uint32_t packetSize = MAX_PACKET_SIZE, bool probe = false) {
+        return AsyncReliable::connect(loop, protocol<Ty>(), ip, port, packetSize, probe);
+    }
+
+    template <typename Ty>
+    Task<std::unique_ptr<AsyncReliable>> accept(EventLoop &loop, uint16_t port,
+                                                uint32_t packetSize = MAX_PACKET_SIZE) {
+        return AsyncReliable::accept(loop, protocol<Ty>(), port, packetSize);
+    }
+}
+
+#endif //RELIABLE_OVER_UDP_ASYNC_RELIABLE_H
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstring>
+#include "checksum.h"
+#include "packet.h"
+
+// checksum microbenchmark
+// program.exe [iterations]
+// every kernel is first checked against the original word-at-a-time
+// implementation, the benchmark refuses to run if any result differs
+
+// the implementation packet.cpp used before the kernels,
+// which relied on a zeroed byte after an odd length packet
+static uint16_t referenceChecksum(const void *buf, int len) {
+    uint32_t sum = 0;
+    const uint16_t *p = reinterpret_cast<const uint16_t *>(buf);
+    for (int i = 0; i < len / 2; i++) {
+        sum += p[i];
+        if (sum & 0xFFFF0000) {
+            sum &= 0xFFFF;
+            sum++;
+        }
+    }
+    if (len % 2) {
+        uint8_t last[2] = {reinterpret_cast<const uint8_t *>(buf)[len - 1], 0};
+        uint16_t word;
+        memcpy(&word, last, sizeof(word));
+        sum += word;
+        if (sum & 0xFFFF0000) {
+            sum &= 0xFFFF;
+            sum++;
+        }
+    }
+    return ~(sum & 0xFFFF);
+}
+
+struct NamedKernel {
+    const char *name;
+    ChecksumKernel::Kernel kernel;
+};
+
+static bool verify(const std::vector<NamedKernel> &kernels) {
+    std::mt19937 rng(12345);
+    std::vector<uint8_t> buf(MAX_PACKET_SIZE + 64);
+
+    for (int round = 0; round < 20000; round++) {
+        size_t len = round < 4096 ? round % 2100 : rng() % (MAX_PACKET_SIZE + 1);
+        size_t offset = rng() % 8;
+        // mostly random data, sometimes all 0xff to stress the carries
+        for (size_t i = 0; i < len; i++) {
+            buf[offset + i] = round % 7 == 0 ? 0xFF : static_cast<uint8_t>(rng());
+        }
+        const uint8_t *data = buf.data() + offset;
+        uint16_t expected = referenceChecksum(data, static_cast<int>(len));
+
+        for (const auto &k: kernels) {
+            uint16_t actual = ~ChecksumKernel::fold(k.kernel(data, len));
+            if (actual != expected) {
+                std::cout << k.name << " mismatch, len " << len << " offset " << offset
+                          << ": " << actual << " != " << expected << std::endl;
+                return false;
+            }
+        }
+
+        // split into up to 3 parts at random points, odd ones included
+        InternetChecksum incremental;
+        size_t first = len == 0 ? 0 : rng() % (len + 1);
+        size_t second = first + (len == first ? 0 : rng() % (len - first + 1));
+        incremental.update(data, first);
+        incremental.update(data + first, second - first);
+        incremental.update(data + second, len - second);
+        if (incremental.finish() != expected) {
+            std::cout << "incremental mismatch, len " << len << " split " << first << "/" << second
+                      << ": " << incremental.finish() << " != " << expected << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename F>
+static void bench(const char *name, size_t len, int iterations, F &&f) {
+    std::vector<uint8_t> buf(len);
+    std::mt19937 rng(len);
+    for (auto &b: buf) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    volatile uint16_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink = sink + f(buf.data(), len);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::left << std::setw(12) << name
+              << std::right << std::setw(8) << len << " B "
+              << std::setw(10) << std::fixed << std::setprecision(1) << elapsed * 1e9 / iterations << " ns/op "
+              << std::setw(8) << std::setprecision(2) << len * iterations / elapsed / 1e9 << " GB/s"
+              << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 200000;
+
+    std::vector<NamedKernel> kernels{{"scalar", ChecksumKernel::scalar}};
+    if (auto k = ChecksumKernel::sse2()) {
+        kernels.push_back({"sse2", k});
+    }
+    if (auto k = ChecksumKernel::avx2()) {
+        kernels.push_back({"avx2", k});
+    }
+
+    if (!verify(kernels)) {
+        return 1;
+    }
+    std::cout << "all kernels match the reference, runtime pick: " << ChecksumKernel::bestName() << std::endl;
+
+    for (size_t len: {12, 64, 1472, MAX_PACKET_SIZE}) {
+        bench("reference", len, iterations, [](const uint8_t *buf, size_t len) {
+            return referenceChecksum(buf, static_cast<int>(len));
+        });
+        for (const auto &k: kernels) {
+            bench(k.name, len, iterations, [&k](const uint8_t *buf, size_t len) {
+                return static_cast<uint16_t>(~ChecksumKernel::fold(k.kernel(buf, len)));
+            });
+        }
+    }
+
+    return 0;
+}
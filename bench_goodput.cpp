@@ -0,0 +1,294 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "reliable_GBN.h"
+#include "reliable_SR.h"
+#include "reliable_RENO.h"
+#include "reliable_helper.h"
+#include "impair_proxy.h"
+
+// end-to-end goodput benchmark, the server and client paths of the main
+// program in one process, over loopback and through the impairment proxy
+// program.exe [options]
+//   --methods GBN,SR,RENO
+//   --sizes 4            MB per transfer
+//   --windows 16,64      N of GBN and SR, initial slow start threshold of RENO
+//   --loss 0,0.01        random loss, both ways
+//   --rtt 0,10           ms, half of it each way
+//   --runs 5             transfers per configuration, for the percentiles
+//   --port 42000         first of the ports used, two more per transfer
+//   --format csv|json
+// every combination is one line, the exit code is 1 if any transfer failed
+//
+// cpu time is what the server and client threads used, without the proxy,
+// resends are counted from the payload the server put on the wire
+
+struct Config {
+    std::string method;
+    uint64_t size;
+    uint32_t window;
+    double loss;
+    double rttMs;
+};
+
+struct Run {
+    bool ok;
+    double seconds;
+    double cpuSeconds;
+    double retransmissionRatio;
+};
+
+static double threadCpuTime() {
+#ifdef __linux__
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+#else
+    // the whole process, proxy included
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+template <typename Ty>
+static Run transfer(const Config &config, uint16_t port, uint64_t seed, const std::vector<uint8_t> &data) {
+    uint16_t serverPort = port;
+    uint16_t proxyPort = port + 1;
+
+    ImpairmentConfig link;
+    link.loss = config.loss;
+    link.delay = std::chrono::duration_cast<ImpairmentConfig::Duration>(
+            std::chrono::duration<double, std::milli>(config.rttMs / 2));
+    ImpairmentConfig forward = link;
+    ImpairmentConfig backward = link;
+    forward.seed = seed * 2;
+    backward.seed = seed * 2 + 1;
+    ImpairProxy proxy(proxyPort, "127.0.0.1", serverPort, forward, backward);
+    std::thread proxyThread([&proxy] { proxy.run(); });
+
+    double serverCpu = 0;
+    bool sent = false;
+    std::thread serverThread([&] {
+        try {
+            auto reliable = ReliableHelper::listen<Ty>(serverPort, MAX_PACKET_SIZE, Ty::defaultCongestion,
+                                                       config.window);
+            double start = threadCpuTime();
+            MemorySource source(data.data(), data.size());
+            sent = reliable->send(source);
+            serverCpu = threadCpuTime() - start;
+        } catch (const std::exception &e) {
+            std::cerr << "server failed: " << e.what() << std::endl;
+        }
+    });
+
+    // the server binds before its SYN arrives, or the handshake retries
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    Run run{false, 0, 0, 0};
+    std::vector<uint8_t> buffer(data.size());
+    auto start = std::chrono::steady_clock::now();
+    try {
+        auto reliable = ReliableHelper::connect<Ty>("127.0.0.1", proxyPort);
+        double cpuStart = threadCpuTime();
+        uint64_t received = reliable->recv(buffer.data(), buffer.size());
+        run.cpuSeconds = threadCpuTime() - cpuStart;
+        run.ok = received == data.size() && memcmp(buffer.data(), data.data(), data.size()) == 0;
+    } catch (const std::exception &e) {
+        std::cerr << "client failed: " << e.what() << std::endl;
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    serverThread.join();
+    proxy.stop();
+    proxyThread.join();
+
+    run.ok = run.ok && sent;
+    run.cpuSeconds += serverCpu;
+    // what the server sent towards the client, less the headers
+    auto wire = proxy.backwardCounters();
+    uint64_t payload = wire.bytes - wire.datagrams * sizeof(Packet);
+    run.retransmissionRatio = static_cast<double>(payload) / static_cast<double>(data.size()) - 1;
+    return run;
+}
+
+static Run transfer(const Config &config, uint16_t port, uint64_t seed, const std::vector<uint8_t> &data) {
+    if (config.method == "GBN") {
+        return transfer<ReliableGBN>(config, port, seed, data);
+    } else if (config.method == "SR") {
+        return transfer<ReliableSR>(config, port, seed, data);
+    }
+    return transfer<ReliableRENO>(config, port, seed, data);
+}
+
+// nearest rank
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    auto rank = static_cast<size_t>(std::ceil(p / 100 * static_cast<double>(values.size())));
+    return values[(std::max)(rank, size_t(1)) - 1];
+}
+
+template <typename Ty>
+static std::vector<Ty> parseList(const std::string &arg) {
+    std::vector<Ty> values;
+    std::stringstream stream(arg);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::stringstream itemStream(item);
+        Ty value;
+        itemStream >> value;
+        values.push_back(value);
+    }
+    return values;
+}
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (result != 0) {
+        std::cout << "WSAStartup failed: " << result << std::endl;
+        return 1;
+    }
+#endif
+
+    std::vector<std::string> methods = {"GBN", "SR", "RENO"};
+    std::vector<uint64_t> sizes = {4};
+    std::vector<uint32_t> windows = {16, 64};
+    std::vector<double> losses = {0, 0.01};
+    std::vector<double> rtts = {0, 10};
+    int runs = 5;
+    uint16_t port = 42000;
+    std::string format = "csv";
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view option = argv[i];
+        if (i + 1 >= argc) {
+            std::cout << "missing value for " << option << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        if (option == "--methods") {
+            methods = parseList<std::string>(value);
+        } else if (option == "--sizes") {
+            sizes = parseList<uint64_t>(value);
+        } else if (option == "--windows") {
+            windows = parseList<uint32_t>(value);
+        } else if (option == "--loss") {
+            losses = parseList<double>(value);
+        } else if (option == "--rtt") {
+            rtts = parseList<double>(value);
+        } else if (option == "--runs") {
+            runs = (std::max)(std::stoi(value), 1);
+        } else if (option == "--port") {
+            port = std::stoi(value);
+        } else if (option == "--format") {
+            format = value;
+        } else {
+            std::cout << "unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+    for (const auto &method: methods) {
+        if (method != "GBN" && method != "SR" && method != "RENO") {
+            std::cout << "unknown method: " << method << std::endl;
+            return 1;
+        }
+    }
+    if (format != "csv" && format != "json") {
+        std::cout << "unknown format: " << format << std::endl;
+        return 1;
+    }
+
+    Log::setLevel(LogLevel::ERR);
+
+    std::vector<Config> configs;
+    for (const auto &method: methods) {
+        for (uint64_t size: sizes) {
+            for (uint32_t window: windows) {
+                for (double loss: losses) {
+                    for (double rttMs: rtts) {
+                        configs.push_back({method, size * 1024 * 1024, window, loss, rttMs});
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t largest = *std::max_element(sizes.begin(), sizes.end()) * 1024 * 1024;
+    std::vector<uint8_t> data(largest);
+    std::mt19937 rng(42);
+    for (auto &b: data) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    if (format == "csv") {
+        std::cout << "method,size_mb,window,loss,rtt_ms,runs,failed,goodput_mbit,retransmission_ratio,"
+                     "cpu_s_per_gb,p50_ms,p99_ms" << std::endl;
+    } else {
+        std::cout << "[" << std::endl;
+    }
+
+    bool allOk = true;
+    for (size_t c = 0; c < configs.size(); c++) {
+        const Config &config = configs[c];
+        std::vector<uint8_t> payload(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(config.size));
+
+        std::vector<double> seconds;
+        double retransmissions = 0;
+        double cpu = 0;
+        int failed = 0;
+        for (int r = 0; r < runs; r++) {
+            Run run = transfer(config, port, r + 1, payload);
+            // fresh ports each time, late datagrams of the last run go nowhere
+            port += 2;
+            if (!run.ok) {
+                failed++;
+                continue;
+            }
+            seconds.push_back(run.seconds);
+            retransmissions += run.retransmissionRatio;
+            cpu += run.cpuSeconds;
+        }
+        allOk = allOk && failed == 0;
+
+        int done = runs - failed;
+        double p50 = percentile(seconds, 50);
+        double p99 = percentile(seconds, 99);
+        double goodput = p50 > 0 ? static_cast<double>(config.size) * 8 / p50 / 1e6 : 0;
+        double retransmissionRatio = done > 0 ? retransmissions / done : 0;
+        double cpuPerGb = done > 0 ? cpu / done * (1024.0 * 1024 * 1024) / static_cast<double>(config.size) : 0;
+        uint64_t sizeMb = config.size / (1024 * 1024);
+
+        if (format == "csv") {
+            std::cout << config.method << "," << sizeMb << "," << config.window << "," << config.loss << ","
+                      << config.rttMs << "," << runs << "," << failed << "," << goodput << ","
+                      << retransmissionRatio << "," << cpuPerGb << "," << p50 * 1000 << "," << p99 * 1000
+                      << std::endl;
+        } else {
+            std::cout << "  {\"method\": \"" << config.method << "\", \"size_mb\": " << sizeMb
+                      << ", \"window\": " << config.window << ", \"loss\": " << config.loss
+                      << ", \"rtt_ms\": " << config.rttMs << ", \"runs\": " << runs << ", \"failed\": " << failed
+                      << ", \"goodput_mbit\": " << goodput << ", \"retransmission_ratio\": " << retransmissionRatio
+                      << ", \"cpu_s_per_gb\": " << cpuPerGb << ", \"p50_ms\": " << p50 * 1000
+                      << ", \"p99_ms\": " << p99 * 1000 << "}" << (c + 1 < configs.size() ? "," : "") << std::endl;
+        }
+    }
+
+    if (format == "json") {
+        std::cout << "]" << std::endl;
+    }
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <span>
+#include <vector>
+#include "log.h"
+#include "packet.h"
+#include "packet_pool.h"
+#include "unreliable.h"
+#include "reliable_helper.h"
+#include "reliable_SR.h"
+#include "async_reliable.h"
+#include "event_loop.h"
+#include "task.h"
+#include "session_GBN.h"
+#include "session_SR.h"
+#include "session_RENO.h"
+#include "simulator.h"
+
+// microbenchmarks of the hot paths, for several payload sizes
+// program.exe [iterations] [port]
+//   build    PacketHelper::makePacket, header, checksum and copy
+//   slice    PacketHelper::makeSlice, header and checksum, no copy
+//   validate PacketHelper::isValidPacket
+//   udp      Unreliable batched send and recv of 64 slices over loopback
+//   GBN/SR/RENO  one slice pushed through sender and receiver and acked,
+//           on the simulator's clock and a clean link, window 64 for GBN and SR
+//   async    AsyncReliable accept, connect and a transfer over loopback, both
+//           ends as coroutines on one EventLoop, SR, one op per payload of
+//           the size, up to 16 MB, checked byte for byte
+// allocations are every operator new of the process, the packet pool's
+// included, while the benchmark runs, for the push/ack cycles that is the
+// timers and packets in flight of the simulator too
+
+static std::atomic<uint64_t> allocations = 0;
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// f runs the benchmark and returns the number of ops it did
+template <typename F>
+static void bench(const char *name, size_t len, F &&f) {
+    uint64_t allocatedBefore = allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t ops = f();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocatedBefore;
+
+    std::cout << std::left << std::setw(10) << name
+              << std::right << std::setw(8) << len << " B "
+              << std::setw(10) << std::fixed << std::setprecision(1) << elapsed * 1e9 / ops << " ns/op "
+              << std::setw(9) << std::setprecision(1) << len * ops / elapsed / 1e6 << " MB/s "
+              << std::setw(7) << std::setprecision(3) << static_cast<double>(allocated) / ops << " allocs/op"
+              << std::endl;
+}
+
+static uint64_t udp(const std::vector<uint8_t> &payload, int iterations, uint16_t port) {
+    SOCKET receiving = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    SOCKET sending = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ReliableHelper::setBufferSize(receiving);
+    ReliableHelper::setBufferSize(sending);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (bind(receiving, (sockaddr *) &addr, sizeof(addr)) == SOCKET_ERROR) {
+        std::cout << "bind() failed: " << lastSocketError() << std::endl;
+        closesocket(receiving);
+        closesocket(sending);
+        return 1;
+    }
+    Unreliable receiver(receiving);
+    Unreliable sender(sending, "127.0.0.1", port);
+
+    std::vector<PacketSlice> slices;
+    std::vector<const PacketSlice *> batch;
+    for (uint32_t i = 0; i < MAX_BATCH_SIZE; i++) {
+        slices.push_back(PacketHelper::makeSlice(i, payload.data(), static_cast<uint32_t>(payload.size())));
+    }
+    for (const auto &slice: slices) {
+        batch.push_back(&slice);
+    }
+
+    // one batch out, then all of it in, so the socket never overflows
+    std::vector<PacketPtr> packets;
+    uint64_t received = 0;
+    int rounds = (std::max)(iterations / MAX_BATCH_SIZE, 1);
+    for (int round = 0; round < rounds; round++) {
+        int sent = sender.send(batch);
+        int got = 0;
+        while (got < sent && receiver.recv(packets, std::chrono::milliseconds(100)) > 0) {
+            got += static_cast<int>(packets.size());
+            packets.clear();
+        }
+        received += got;
+    }
+    return (std::max)(received, uint64_t(1));
+}
+
+// the most async moves, the window of SR is small
+const static uint64_t asyncLimit = 16 * 1024 * 1024;
+
+static uint64_t async(const std::vector<uint8_t> &payload, int iterations, uint16_t port) {
+    uint64_t ops = (std::max)((std::min)(static_cast<uint64_t>(iterations), asyncLimit / payload.size()),
+                              uint64_t(1));
+    std::vector<uint8_t> data(ops * payload.size());
+    for (uint64_t i = 0; i < data.size(); i++) {
+        data[i] = payload[i % payload.size()];
+    }
+    std::vector<uint8_t> buffer(data.size());
+
+    EventLoop loop;
+    bool sent = false;
+    uint64_t received = 0;
+    int done = 0;
+    auto server = [&]() -> Task<void> {
+        try {
+            auto connection = co_await AsyncHelper::accept<ReliableSR>(loop, port);
+            sent = co_await connection->send(std::span<const uint8_t>(data));
+        } catch (const std::exception &e) {
+            std::cout << "async server failed: " << e.what() << std::endl;
+        }
+        done++;
+    };
+    auto client = [&]() -> Task<void> {
+        try {
+            auto connection = co_await AsyncHelper::connect<ReliableSR>(loop, "127.0.0.1", port);
+            received = co_await connection->recv(std::span<uint8_t>(buffer));
+        } catch (const std::exception &e) {
+            std::cout << "async client failed: " << e.what() << std::endl;
+        }
+        done++;
+    };
+
+    // the server waits for its SYN before the client sends it
+    TaskHelper::spawn(server());
+    TaskHelper::spawn(client());
+    loop.run([&done] { return done == 2; });
+
+    if (!sent || received != data.size() || buffer != data) {
+        std::cout << "async transfer failed" << std::endl;
+    }
+    return ops;
+}
+
+template <typename Sender, typename Receiver>
+static uint64_t cycle(size_t len, int iterations, uint32_t window) {
+    SimulationSetup setup;
+    setup.packetSize = static_cast<uint32_t>(len + sizeof(Packet));
+    setup.size = static_cast<uint64_t>(len) * iterations;
+    auto result = SimulatorHelper::simulate(setup, [window](ITransport &transport, ITimerService &timers,
+                                                            RttEstimator &rtt, ISource &source) {
+        if constexpr (std::is_same_v<Sender, SenderRENO>) {
+            return std::make_unique<Sender>(transport, timers, rtt, source);
+        } else {
+            return std::make_unique<Sender>(transport, timers, rtt, source, window);
+        }
+    }, [](ITransport &transport, ITimerService &timers, ISink &sink) {
+        return std::make_unique<Receiver>(transport, timers, sink);
+    });
+    if (!result.succeeded) {
+        std::cout << "transfer failed" << std::endl;
+    }
+    return result.slices;
+}
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (result != 0) {
+        std::cout << "WSAStartup failed: " << result << std::endl;
+        return 1;
+    }
+#endif
+
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 100000;
+    uint16_t port = argc > 2 ? std::stoi(argv[2]) : 43000;
+
+    Log::setLevel(LogLevel::ERR);
+
+    for (size_t len: {size_t(64), size_t(512), size_t(1400), size_t(4096), MAX_PACKET_SIZE - sizeof(Packet)}) {
+        std::vector<uint8_t> payload(len);
+        std::mt19937 rng(static_cast<uint32_t>(len));
+        for (auto &b: payload) {
+            b = static_cast<uint8_t>(rng());
+        }
+        auto packet = PacketHelper::makePacket(PacketType::DATA, 0, payload.data(), static_cast<uint32_t>(len));
+
+        bench("build", len, [&] {
+            for (int i = 0; i < iterations; i++) {
+                auto built = PacketHelper::makePacket(PacketType::DATA, i, payload.data(), static_cast<uint32_t>(len));
+                if (built->len == 0) {
+                    std::cout << "empty packet" << std::endl;
+                }
+            }
+            return static_cast<uint64_t>(iterations);
+        });
+
+        bench("slice", len, [&] {
+            volatile uint16_t checksum = 0;
+            for (int i = 0; i < iterations; i++) {
+                auto slice = PacketHelper::makeSlice(i, payload.data(), static_cast<uint32_t>(len));
+                checksum = checksum + slice.header.checksum;
+            }
+            return static_cast<uint64_t>(iterations);
+        });
+
+        bench("validate", len, [&] {
+            uint64_t valid = 0;
+            for (int i = 0; i < iterations; i++) {
+                valid += PacketHelper::isValidPacket(packet);
+            }
+            if (valid != static_cast<uint64_t>(iterations)) {
+                std::cout << "invalid packet" << std::endl;
+            }
+            return static_cast<uint64_t>(iterations);
+        });
+
+        bench("udp", len, [&] {
+            return udp(payload, iterations, port++);
+        });
+
+        bench("GBN", len, [&] {
+            return cycle<SenderGBN, ReceiverGBN>(len, iterations, 64);
+        });
+        bench("SR", len, [&] {
+            return cycle<SenderSR, ReceiverSR>(len, iterations, 64);
+        });
+        bench("RENO", len, [&] {
+            return cycle<SenderRENO, ReceiverRENO>(len, iterations, 0);
+        });
+
+        bench("async", len, [&] {
+            return async(payload, iterations, port++);
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "reliable_GBN.h"
+#include "reliable_SR.h"
+#include "reliable_RENO.h"
+#include "reliable_helper.h"
+
+// multi-core scaling benchmark of the sharded server, over loopback
+// program.exe [method] [clients] [sizeMB] [max workers] [port]
+// for 1, 2, 4, ... workers, every client downloads the same buffer at
+// once and the aggregate throughput is printed, clients run in this
+// process too, so they compete with the workers for the same cores
+
+struct Result {
+    double seconds;
+    int completed;
+};
+
+template <typename Ty>
+static Result run(uint16_t port, int workers, int clients, const std::vector<uint8_t> &data) {
+    auto server = ReliableHelper::serve<Ty>(port, [&data] {
+        return std::make_unique<MemorySource>(data.data(), data.size());
+    }, workers);
+    std::thread serverThread([&server] { server->run(); });
+
+    std::vector<std::vector<uint8_t>> buffers(clients, std::vector<uint8_t>(data.size()));
+    std::vector<int> ok(clients, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; i++) {
+        threads.emplace_back([&, i] {
+            try {
+                auto reliable = ReliableHelper::connect<Ty>("127.0.0.1", port);
+                uint64_t received = reliable->recv(buffers[i].data(), buffers[i].size());
+                ok[i] = received == data.size() && memcmp(buffers[i].data(), data.data(), data.size()) == 0;
+            } catch (const std::exception &e) {
+                std::cout << "client " << i << " failed: " << e.what() << std::endl;
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    server->stop();
+    serverThread.join();
+
+    int completed = 0;
+    for (int v: ok) {
+        completed += v;
+    }
+    return {elapsed, completed};
+}
+
+int main(int argc, char *argv[]) {
+    std::string method = argc > 1 ? argv[1] : "SR";
+    int clients = argc > 2 ? std::stoi(argv[2]) : 16;
+    uint64_t size = (argc > 3 ? std::stoull(argv[3]) : 8) * 1024 * 1024;
+    int maxWorkers = argc > 4 ? std::stoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+    uint16_t port = argc > 5 ? std::stoi(argv[5]) : 40000;
+    maxWorkers = (std::max)(maxWorkers, 1);
+
+    Log::setLevel(LogLevel::WARN);
+
+    std::vector<uint8_t> data(size);
+    std::mt19937 rng(42);
+    for (auto &b: data) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    std::vector<int> steps;
+    for (int workers = 1; workers < maxWorkers; workers *= 2) {
+        steps.push_back(workers);
+    }
+    steps.push_back(maxWorkers);
+
+    std::cout << method << ", " << clients << " clients x " << size / (1024 * 1024) << " MB, "
+              << std::thread::hardware_concurrency() << " cores" << std::endl;
+
+    double baseline = 0;
+    for (int workers: steps) {
+        Result result;
+        if (method == "GBN") {
+            result = run<ReliableGBN>(port, workers, clients, data);
+        } else if (method == "SR") {
+            result = run<ReliableSR>(port, workers, clients, data);
+        } else if (method == "RENO") {
+            result = run<ReliableRENO>(port, workers, clients, data);
+        } else {
+            std::cout << "unknown method: " << method << std::endl;
+            return 1;
+        }
+
+        double throughput = static_cast<double>(size) * result.completed / result.seconds / 1e6;
+        if (baseline == 0) {
+            baseline = throughput;
+        }
+        std::cout << std::setw(3) << workers << " workers "
+                  << std::setw(8) << std::fixed << std::setprecision(1) << throughput << " MB/s "
+                  << std::setw(6) << std::setprecision(2) << throughput / baseline << "x "
+                  << result.completed << "/" << clients << " complete" << std::endl;
+
+        if (result.completed != clients) {
+            return 1;
+        }
+        // a fresh port each round, late datagrams of the last one go nowhere
+        port++;
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <cstring>
+#include "checksum.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHECKSUM_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// the bytes left after the wide loop, read as zero padded 32-bit words,
+// which keeps every 16-bit word in its place
+static uint64_t sumTail(const uint8_t *buf, size_t len) {
+    uint64_t sum = 0;
+    while (len >= 4) {
+        uint32_t word;
+        memcpy(&word, buf, 4);
+        sum += word;
+        buf += 4;
+        len -= 4;
+    }
+    if (len > 0) {
+        uint32_t word = 0;
+        memcpy(&word, buf, len);
+        sum += word;
+    }
+    return sum;
+}
+
+uint64_t ChecksumKernel::scalar(const uint8_t *buf, size_t len) {
+    // 4 independent accumulators, so the adds can run in parallel
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    while (len >= 32) {
+        uint64_t w[4];
+        memcpy(w, buf, 32);
+        s0 += (w[0] & 0xFFFFFFFF) + (w[0] >> 32);
+        s1 += (w[1] & 0xFFFFFFFF) + (w[1] >> 32);
+        s2 += (w[2] & 0xFFFFFFFF) + (w[2] >> 32);
+        s3 += (w[3] & 0xFFFFFFFF) + (w[3] >> 32);
+        buf += 32;
+        len -= 32;
+    }
+    return s0 + s1 + s2 + s3 + sumTail(buf, len);
+}
+
+#ifdef CHECKSUM_X86_SIMD
+
+// widen 32-bit words into 64-bit lanes and add them up,
+// a lane cannot overflow before 2^32 words (16 GiB)
+
+static uint64_t sumSSE2(const uint8_t *buf, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero;
+    while (len >= 32) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 16));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(a, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(a, zero));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(b, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(b, zero));
+        buf += 32;
+        len -= 32;
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + sumTail(buf, len);
+}
+
+__attribute__((target("avx2")))
+static uint64_t sumAVX2(const uint8_t *buf, size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+    while (len >= 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(a, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(a, zero));
+        acc2 = _mm256_add_epi64(acc2, _mm256_unpacklo_epi32(b, zero));
+        acc3 = _mm256_add_epi64(acc3, _mm256_unpackhi_epi32(b, zero));
+        buf += 64;
+        len -= 64;
+    }
+
+    __m256i acc = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumTail(buf, len);
+}
+
+ChecksumKernel::Kernel ChecksumKernel::sse2() {
+    return __builtin_cpu_supports("sse2") ? sumSSE2 : nullptr;
+}
+
+ChecksumKernel::Kernel ChecksumKernel::avx2() {
+    return __builtin_cpu_supports("avx2") ? sumAVX2 : nullptr;
+}
+
+#else
+
+ChecksumKernel::Kernel ChecksumKernel::sse2() {
+    return nullptr;
+}
+
+ChecksumKernel::Kernel ChecksumKernel::avx2() {
+    return nullptr;
+}
+
+#endif
+
+namespace {
+    struct Dispatch {
+        ChecksumKernel::Kernel kernel;
+        const char *name;
+
+        Dispatch() {
+            if (auto k = ChecksumKernel::avx2()) {
+                kernel = k;
+                name = "avx2";
+            } else if (auto k = ChecksumKernel::sse2()) {
+                kernel = k;
+                name = "sse2";
+            } else {
+                kernel = ChecksumKernel::scalar;
+                name = "scalar";
+            }
+        }
+    };
+
+    const Dispatch &dispatch() {
+        static const Dispatch d;
+        return d;
+    }
+}
+
+ChecksumKernel::Kernel ChecksumKernel::best() {
+    return dispatch().kernel;
+}
+
+const char *ChecksumKernel::bestName() {
+    return dispatch().name;
+}
+
+uint16_t ChecksumKernel::fold(uint64_t sum) {
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(sum);
+}
+
+void InternetChecksum::update(const void *buf, size_t len) {
+    uint16_t partial = ChecksumKernel::fold(
+            ChecksumKernel::best()(reinterpret_cast<const uint8_t *>(buf), len));
+
+    // the buffer starts in the middle of a 16-bit word,
+    // its words are byte swapped relative to the total
+    if (odd) {
+        partial = static_cast<uint16_t>((partial << 8) | (partial >> 8));
+    }
+
+    sum += partial;
+    odd ^= (len % 2) != 0;
+}
+
+uint16_t InternetChecksum::finish() const {
+    return ~ChecksumKernel::fold(sum);
+}
+
+uint16_t ChecksumHelper::checksum(const void *buf, size_t len) {
+    return ~ChecksumKernel::fold(ChecksumKernel::best()(reinterpret_cast<const uint8_t *>(buf), len));
+}
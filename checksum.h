@@ -0,0 +1,46 @@
+#ifndef RELIABLE_OVER_UDP_CHECKSUM_H
+#define RELIABLE_OVER_UDP_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// internet checksum (RFC 1071) over native order 16-bit words,
+// an odd trailing byte is padded with a zero byte
+
+namespace ChecksumKernel {
+    // unfolded one's complement sum of buf, as 32-bit words added
+    // into a 64-bit accumulator (the carries are folded at the end)
+    using Kernel = uint64_t (*)(const uint8_t *buf, size_t len);
+
+    uint64_t scalar(const uint8_t *buf, size_t len);
+
+    // nullptr when the cpu (or the compiler) does not support it
+    Kernel sse2();
+
+    Kernel avx2();
+
+    // picked at startup, the fastest one the cpu supports
+    Kernel best();
+
+    const char *bestName();
+
+    // fold an accumulator down to 16 bits
+    uint16_t fold(uint64_t sum);
+}
+
+// checksum over several buffers, as if they were contiguous
+class InternetChecksum {
+    uint64_t sum = 0;
+    bool odd = false;
+public:
+    void update(const void *buf, size_t len);
+
+    // the complement of the sum, what goes into the header
+    uint16_t finish() const;
+};
+
+namespace ChecksumHelper {
+    uint16_t checksum(const void *buf, size_t len);
+}
+
+#endif //RELIABLE_OVER_UDP_CHECKSUM_H
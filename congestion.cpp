@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <cmath>
+#include "log.h"
+#include "congestion.h"
+
+using Seconds = std::chrono::duration<double>;
+
+// window based controllers pace a little faster than cwnd per srtt, so
+// the pacer never holds back what the window allows (as linux does)
+const static double slowStartPacingGain = 2.0;
+const static double avoidancePacingGain = 1.2;
+
+static double windowPacingRate(double cwnd, bool slowStart, ICongestionControl::Clock::duration srtt) {
+    if (srtt <= ICongestionControl::Clock::duration::zero()) {
+        return 0;
+    }
+    double gain = slowStart ? slowStartPacingGain : avoidancePacingGain;
+    return gain * cwnd / Seconds(srtt).count();
+}
+
+RenoControl::RenoControl(uint32_t threshold)
+        : threshold(static_cast<float>(threshold)) {}
+
+void RenoControl::onAck(const Ack &ack) {
+    srtt = ack.srtt;
+
+    if (ack.acked == 0) {
+        // window inflation, every further duplicate means a slice left the network
+        if (recovering) {
+            cwnd++;
+        }
+    } else {
+        recovering = false;
+        if (cwnd < threshold) {
+            cwnd++;
+        } else {
+            cwnd += 1 / cwnd;
+        }
+    }
+    // a window as large as it may ever be is all cwnd can be
+    cwnd = (std::min)(cwnd, static_cast<float>(maxWindow));
+    LOG_TRACE << "RENO: " << "cwnd: " << cwnd << " threshold: " << threshold << std::endl;
+}
+
+void RenoControl::onLoss(Clock::time_point) {
+    threshold = cwnd / 2;
+    cwnd = threshold + 3;
+    recovering = true;
+    LOG_TRACE << "RENO: " << "cwnd: " << cwnd << " threshold: " << threshold << std::endl;
+}
+
+void RenoControl::onTimeout(Clock::time_point) {
+    threshold = cwnd / 2;
+    cwnd = 1;
+    recovering = false;
+    LOG_TRACE << "RENO: " << "cwnd: " << cwnd << " threshold: " << threshold << std::endl;
+}
+
+uint32_t RenoControl::window() const {
+    return static_cast<uint32_t>(std::ceil(cwnd));
+}
+
+uint32_t RenoControl::slowStartThreshold() const {
+    return static_cast<uint32_t>(std::ceil(threshold));
+}
+
+double RenoControl::pacingRate() const {
+    return windowPacingRate(cwnd, cwnd < threshold, srtt);
+}
+
+// RFC 6928
+const static double initialWindow = 10;
+
+CubicControl::CubicControl()
+        : cwnd(initialWindow) {}
+
+void CubicControl::onAck(const Ack &ack) {
+    srtt = ack.srtt;
+    if (ack.acked == 0) {
+        return;
+    }
+
+    if (cwnd < threshold) {
+        cwnd += ack.acked;
+    } else {
+        if (!epochStart) {
+            epochStart = ack.now;
+            if (cwnd < wMax) {
+                K = std::cbrt((wMax - cwnd) / C);
+                origin = wMax;
+            } else {
+                K = 0;
+                origin = cwnd;
+            }
+            wEst = cwnd;
+        }
+
+        // where the cubic curve is one rtt from now, but at most 1.5 cwnd
+        double t = Seconds(ack.now - *epochStart + srtt).count();
+        double target = origin + C * std::pow(t - K, 3);
+        target = std::clamp(target, cwnd, 1.5 * cwnd);
+
+        // Reno's additive increase, with the same average rate at beta
+        wEst += ack.acked * (3 * (1 - beta) / (1 + beta)) / cwnd;
+
+        if (wEst > target) {
+            cwnd = (std::max)(cwnd, wEst);
+        } else {
+            cwnd += (target - cwnd) / cwnd * ack.acked;
+        }
+    }
+    cwnd = (std::min)(cwnd, static_cast<double>(maxWindow));
+    LOG_TRACE << "CUBIC: cwnd: " << cwnd << " wMax: " << wMax << std::endl;
+}
+
+void CubicControl::onLoss(Clock::time_point) {
+    // fast convergence, a flow which keeps losing below its last maximum
+    // leaves room to flows which just started
+    wMax = cwnd < wMax ? cwnd * (1 + beta) / 2 : cwnd;
+    threshold = (std::max)(cwnd * beta, 2.0);
+    cwnd = threshold;
+    epochStart.reset();
+    LOG_TRACE << "CUBIC: loss, cwnd: " << cwnd << " wMax: " << wMax << std::endl;
+}
+
+void CubicControl::onTimeout(Clock::time_point) {
+    wMax = cwnd;
+    threshold = (std::max)(cwnd * beta, 2.0);
+    cwnd = 1;
+    epochStart.reset();
+    LOG_TRACE << "CUBIC: timeout, cwnd: " << cwnd << " wMax: " << wMax << std::endl;
+}
+
+uint32_t CubicControl::window() const {
+    return static_cast<uint32_t>(std::ceil(cwnd));
+}
+
+uint32_t CubicControl::slowStartThreshold() const {
+    return static_cast<uint32_t>(std::ceil(threshold));
+}
+
+double CubicControl::pacingRate() const {
+    return windowPacingRate(cwnd, cwnd < threshold, srtt);
+}
+
+// 2 / ln 2, the smallest gain which doubles the delivery rate every round
+const static double highGain = 2.885;
+// probe for more bandwidth for one round, drain the queue it built for
+// one, then cruise for six
+const static double probeGains[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+const static int probeGainCount = sizeof(probeGains) / sizeof(probeGains[0]);
+// the bandwidth filter keeps the max of this many rounds
+const static uint64_t bandwidthRounds = 10;
+// min rtt older than this is measured again with an almost empty pipe
+const static auto minRttExpiry = std::chrono::seconds(10);
+const static auto probeRttDuration = std::chrono::milliseconds(200);
+const static uint32_t minWindow = 4;
+
+BbrControl::BbrControl()
+        : pacingGain(highGain), cwndGain(highGain) {}
+
+void BbrControl::enter(State next, Clock::time_point now) {
+    state = next;
+    switch (next) {
+        case State::STARTUP:
+            pacingGain = highGain;
+            cwndGain = highGain;
+            break;
+        case State::DRAIN:
+            pacingGain = 1 / highGain;
+            cwndGain = highGain;
+            break;
+        case State::PROBE_BW:
+            cycleIndex = 0;
+            cycleStart = now;
+            pacingGain = probeGains[cycleIndex];
+            cwndGain = 2;
+            break;
+        case State::PROBE_RTT:
+            pacingGain = 1;
+            cwndGain = 1;
+            probeRttDone = now + probeRttDuration;
+            break;
+    }
+    LOG_TRACE << "BBR: state " << static_cast<int>(next) << std::endl;
+}
+
+double BbrControl::bdp() const {
+    if (bandwidth == 0 || minRtt == Clock::duration::max()) {
+        return 0;
+    }
+    return bandwidth * Seconds(minRtt).count();
+}
+
+void BbrControl::endRound(Clock::time_point now) {
+    // delivery rate of the round just over
+    double elapsed = Seconds(now - roundStart).count();
+    if (elapsed > 0) {
+        double rate = static_cast<double>(delivered - roundDelivered) / elapsed;
+        samples.push_back({round, rate});
+    }
+    round++;
+    roundDelivered = delivered;
+    roundStart = now;
+
+    while (!samples.empty() && samples.front().round + bandwidthRounds < round) {
+        samples.pop_front();
+    }
+    bandwidth = 0;
+    for (const auto &sample: samples) {
+        bandwidth = (std::max)(bandwidth, sample.rate);
+    }
+
+    if (state == State::STARTUP) {
+        if (bandwidth >= fullBandwidth * 1.25) {
+            fullBandwidth = bandwidth;
+            fullBandwidthRounds = 0;
+        } else if (++fullBandwidthRounds >= 3) {
+            enter(State::DRAIN, now);
+        }
+    }
+}
+
+void BbrControl::updateState(const Ack &ack) {
+    switch (state) {
+        case State::STARTUP:
+            break;
+        case State::DRAIN:
+            // the queue startup built is gone
+            if (ack.inFlight <= bdp()) {
+                enter(State::PROBE_BW, ack.now);
+            }
+            break;
+        case State::PROBE_BW:
+            if (ack.now - cycleStart >= minRtt) {
+                cycleIndex = (cycleIndex + 1) % probeGainCount;
+                cycleStart = ack.now;
+                pacingGain = probeGains[cycleIndex];
+            }
+            break;
+        case State::PROBE_RTT:
+            if (ack.now >= probeRttDone) {
+                minRttStamp = ack.now;
+                enter(fullBandwidth > 0 && fullBandwidthRounds >= 3 ? State::PROBE_BW : State::STARTUP, ack.now);
+            }
+            break;
+    }
+
+    if (state != State::PROBE_RTT && minRtt != Clock::duration::max() && ack.now - minRttStamp > minRttExpiry) {
+        enter(State::PROBE_RTT, ack.now);
+    }
+}
+
+void BbrControl::onAck(const Ack &ack) {
+    if (!started) {
+        started = true;
+        roundStart = ack.now;
+        minRttStamp = ack.now;
+    }
+
+    if (ack.rtt > Clock::duration::zero() && (ack.rtt <= minRtt || ack.now - minRttStamp > minRttExpiry)) {
+        minRtt = ack.rtt;
+        minRttStamp = ack.now;
+    }
+
+    delivered += ack.acked;
+    inFlight = ack.inFlight;
+    Clock::duration roundLength = minRtt != Clock::duration::max() ? minRtt : ack.srtt;
+    if (roundLength > Clock::duration::zero() && ack.now - roundStart >= roundLength) {
+        endRound(ack.now);
+    }
+
+    if (recovering) {
+        if (round > recoveryRound + 1) {
+            // a whole round without a loss
+            recovering = false;
+        } else if (round > recoveryRound) {
+            recoveryWindow += ack.acked;
+        } else {
+            // packet conservation, a slice goes for every slice delivered
+            recoveryWindow = (std::max)(recoveryWindow, static_cast<double>(ack.inFlight + ack.acked));
+        }
+    }
+
+    updateState(ack);
+}
+
+void BbrControl::onLoss(Clock::time_point) {
+    // the model does not react to loss, only what is put on top of it
+    if (!recovering) {
+        recovering = true;
+        recoveryWindow = (std::max)(inFlight, minWindow);
+    }
+    recoveryRound = round;
+}
+
+void BbrControl::onTimeout(Clock::time_point) {
+    // nothing is known to be in flight any more, restart from one slice
+    // and grow with the acks, the model itself is kept
+    recovering = true;
+    recoveryWindow = 1;
+    recoveryRound = round;
+}
+
+uint32_t BbrControl::window() const {
+    uint32_t target;
+    if (state == State::PROBE_RTT) {
+        target = minWindow;
+    } else {
+        double slices = cwndGain * bdp();
+        if (slices == 0) {
+            // no model yet, grow like slow start
+            slices = initialWindow + static_cast<double>(delivered);
+        }
+        target = std::clamp(static_cast<uint32_t>(std::ceil(slices)), minWindow, maxWindow);
+    }
+
+    if (recovering) {
+        target = (std::min)(target, static_cast<uint32_t>(std::ceil(recoveryWindow)));
+    }
+    return (std::max)(target, 1u);
+}
+
+uint32_t BbrControl::slowStartThreshold() const {
+    // startup ends on the bandwidth it sees, not on a window
+    return 0;
+}
+
+double BbrControl::pacingRate() const {
+    return pacingGain * bandwidth;
+}
+
+std::unique_ptr<ICongestionControl> CongestionHelper::create(Congestion algorithm) {
+    switch (algorithm) {
+        case Congestion::RENO:
+            return std::make_unique<RenoControl>(RenoControl::initialThreshold);
+        case Congestion::CUBIC:
+            return std::make_unique<CubicControl>();
+        case Congestion::BBR:
+            return std::make_unique<BbrControl>();
+        default:
+            return nullptr;
+    }
+}
+
+std::optional<Congestion> CongestionHelper::parse(std::string_view name) {
+    if (name == "none") {
+        return Congestion::NONE;
+    } else if (name == "reno") {
+        return Congestion::RENO;
+    } else if (name == "cubic") {
+        return Congestion::CUBIC;
+    } else if (name == "bbr") {
+        return Congestion::BBR;
+    }
+    return std::nullopt;
+}
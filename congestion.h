@@ -0,0 +1,206 @@
+#ifndef RELIABLE_OVER_UDP_CONGESTION_H
+#define RELIABLE_OVER_UDP_CONGESTION_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+enum class Congestion {
+    // a fixed window, no congestion control
+    NONE,
+    RENO,
+    CUBIC,
+    BBR,
+};
+
+// congestion control of one sender, windows are counted in slices
+//
+// the sender reports every SACK, every loss it finds and every timeout,
+// and sends no more than window() slices, paced at pacingRate()
+class ICongestionControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // no controller grows its window beyond this
+    constexpr static uint32_t maxWindow = 1024;
+
+    // what one SACK told
+    struct Ack {
+        Clock::time_point now;
+        // slices newly acknowledged, 0 for a duplicate
+        uint32_t acked;
+        // slices still in flight after it
+        uint32_t inFlight;
+        // round trip sample, zero if it gave none
+        Clock::duration rtt;
+        // zero until the first sample
+        Clock::duration srtt;
+    };
+
+    virtual void onAck(const Ack &ack) = 0;
+
+    // a slice was found lost by duplicate acks or SACK holes, reported
+    // once per window of data
+    virtual void onLoss(Clock::time_point now) = 0;
+
+    virtual void onTimeout(Clock::time_point now) = 0;
+
+    // slices allowed in flight
+    virtual uint32_t window() const = 0;
+
+    // where slow start ends, 0 for a controller without one
+    virtual uint32_t slowStartThreshold() const = 0;
+
+    // slices per second, 0 to send as fast as the window opens
+    virtual double pacingRate() const = 0;
+
+    virtual ~ICongestionControl() = default;
+};
+
+// TCP Reno: slow start, congestion avoidance, halving on loss with
+// window inflation while duplicate acks keep coming, back to 1 on timeout
+class RenoControl : public ICongestionControl {
+    float cwnd = 1;
+    float threshold;
+    bool recovering = false;
+    Clock::duration srtt{};
+
+public:
+    // slow start threshold until the first loss
+    constexpr static uint32_t initialThreshold = 16;
+
+    explicit RenoControl(uint32_t threshold = initialThreshold);
+
+    void onAck(const Ack &ack) override;
+
+    void onLoss(Clock::time_point now) override;
+
+    void onTimeout(Clock::time_point now) override;
+
+    uint32_t window() const override;
+
+    uint32_t slowStartThreshold() const override;
+
+    double pacingRate() const override;
+};
+
+// CUBIC (RFC 9438): after a loss the window follows a cubic function of
+// the time since, back to where the loss happened and then beyond, so it
+// regains a large window in a few RTTs instead of one slice per RTT
+class CubicControl : public ICongestionControl {
+    constexpr static double C = 0.4;
+    constexpr static double beta = 0.7;
+
+    double cwnd;
+    double threshold = maxWindow;
+    // the window at the last loss
+    double wMax = 0;
+    // what Reno would have by now, CUBIC never does worse
+    double wEst = 0;
+    double K = 0;
+    double origin = 0;
+    std::optional<Clock::time_point> epochStart;
+    Clock::duration srtt{};
+
+public:
+    CubicControl();
+
+    void onAck(const Ack &ack) override;
+
+    void onLoss(Clock::time_point now) override;
+
+    void onTimeout(Clock::time_point now) override;
+
+    uint32_t window() const override;
+
+    uint32_t slowStartThreshold() const override;
+
+    double pacingRate() const override;
+};
+
+// after BBR: a model of the path instead of reacting to loss, the
+// bottleneck bandwidth (max delivery rate of the last rounds) and the
+// propagation delay (min rtt of the last seconds), sends at that rate,
+// probing for more now and then, and keeps about a BDP in flight, a
+// loss holds the window at what is in flight for a round (conservation)
+class BbrControl : public ICongestionControl {
+    enum class State {
+        STARTUP,
+        DRAIN,
+        PROBE_BW,
+        PROBE_RTT,
+    };
+
+    struct BandwidthSample {
+        uint64_t round;
+        double rate;
+    };
+
+    State state = State::STARTUP;
+    double pacingGain;
+    double cwndGain;
+
+    // delivery rate samples, one per round, slices per second
+    std::deque<BandwidthSample> samples;
+    double bandwidth = 0;
+    Clock::duration minRtt = Clock::duration::max();
+    Clock::time_point minRttStamp;
+
+    // a round lasts about one rtt, the delivery rate is measured over it
+    uint64_t round = 0;
+    uint64_t delivered = 0;
+    uint64_t roundDelivered = 0;
+    Clock::time_point roundStart;
+    bool started = false;
+
+    // startup ends once the bandwidth stops growing
+    double fullBandwidth = 0;
+    int fullBandwidthRounds = 0;
+
+    int cycleIndex = 0;
+    Clock::time_point cycleStart;
+    Clock::time_point probeRttDone;
+
+    // after a loss the window is held to what is in flight, and grows
+    // only by what is acked, until a round goes by without a loss
+    bool recovering = false;
+    double recoveryWindow = 0;
+    uint64_t recoveryRound = 0;
+    uint32_t inFlight = 0;
+
+    void enter(State next, Clock::time_point now);
+
+    double bdp() const;
+
+    void endRound(Clock::time_point now);
+
+    void updateState(const Ack &ack);
+
+public:
+    BbrControl();
+
+    void onAck(const Ack &ack) override;
+
+    void onLoss(Clock::time_point now) override;
+
+    void onTimeout(Clock::time_point now) override;
+
+    uint32_t window() const override;
+
+    uint32_t slowStartThreshold() const override;
+
+    double pacingRate() const override;
+};
+
+namespace CongestionHelper {
+    // nullptr for NONE
+    std::unique_ptr<ICongestionControl> create(Congestion algorithm);
+
+    // "none", "reno", "cubic" or "bbr", nullopt for anything else
+    std::optional<Congestion> parse(std::string_view name);
+}
+
+#endif //RELIABLE_OVER_UDP_CONGESTION_H
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "log.h"
+#include "handshake.h"
+#include "dispatcher.h"
+
+// many peers share one receive queue, give it room
+const static int socketBufferSize = 8 * 1024 * 1024;
+
+// a reaped peer stays closed for two rto of its session, but at least as
+// long as a client waits for a SYN_ACK before it sends another SYN
+const static auto minTimeWait = std::chrono::seconds(1);
+
+static uint64_t peerKey(const sockaddr_in &peer) {
+    return (static_cast<uint64_t>(peer.sin_addr.s_addr) << 16) | peer.sin_port;
+}
+
+Dispatcher::Dispatcher(uint16_t port, Factory factory, Opener opener, bool reusePort)
+        : factory(std::move(factory)), opener(std::move(opener)) {
+    s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        LOG_ERROR << "socket() failed: " << lastSocketError() << std::endl;
+        throw std::runtime_error("socket() failed");
+    }
+
+    if (reusePort) {
+#ifdef SO_REUSEPORT
+        int enable = 1;
+        if (setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (const char *) &enable, sizeof(enable)) == SOCKET_ERROR) {
+            LOG_ERROR << "setsockopt(SO_REUSEPORT) failed: " << lastSocketError() << std::endl;
+            closesocket(s);
+            throw std::runtime_error("setsockopt(SO_REUSEPORT) failed");
+        }
+#else
+        closesocket(s);
+        throw std::runtime_error("SO_REUSEPORT is not supported");
+#endif
+    }
+
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char *) &socketBufferSize, sizeof(socketBufferSize));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char *) &socketBufferSize, sizeof(socketBufferSize));
+
+    sockaddr_in listenAddr{};
+    listenAddr.sin_family = AF_INET;
+    listenAddr.sin_port = htons(port);
+    listenAddr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(s, (sockaddr *) &listenAddr, sizeof(listenAddr)) == SOCKET_ERROR) {
+        LOG_ERROR << "bind() failed: " << lastSocketError() << std::endl;
+        closesocket(s);
+        throw std::runtime_error("bind() failed");
+    }
+
+    loop.watch(s, [this] { drain(); });
+}
+
+Dispatcher::~Dispatcher() {
+    // sessions go first, their timers live in the loop
+    sessions.clear();
+    loop.unwatch(s);
+    closesocket(s);
+}
+
+void Dispatcher::run() {
+    LOG_INFO << "serving" << std::endl;
+    loop.run([this] {
+        reap();
+        return false;
+    });
+}
+
+void Dispatcher::stop() {
+    loop.stop();
+}
+
+void Dispatcher::dispatch(PacketPtr packet, const sockaddr_in &peer) {
+    uint64_t key = peerKey(peer);
+    auto it = sessions.find(key);
+    Session *session = it != sessions.end() ? it->second.get() : nullptr;
+
+    // counted like Unreliable does for a socket of its own, before the checksum
+    if (session != nullptr) {
+        session->stats.received(1, packet->len);
+    }
+    if (!PacketHelper::isValidPacket(packet)) {
+        if (session != nullptr) {
+            session->stats.checksumFailed();
+        }
+        return;
+    }
+
+    // everything of a known peer goes to its session, a SYN again too
+    if (session != nullptr) {
+        if (!session->session->finished()) {
+            session->session->onPacket(std::move(packet));
+        }
+        return;
+    }
+
+    // anything but a SYN from an unknown peer is a leftover of a finished
+    // session, and so is a SYN from a peer which was just served
+    auto closing = closed.find(key);
+    if (packet->type == PacketType::SYN && closing != closed.end() && closing->second > loop.now()) {
+        LOG_DEBUG << "dropped SYN from closed peer " << inet_ntoa(peer.sin_addr)
+                  << ":" << ntohs(peer.sin_port) << std::endl;
+    } else if (packet->type == PacketType::SYN) {
+        open(peer, key, *packet);
+    } else {
+        LOG_TRACE << "dropped packet from unknown peer" << std::endl;
+    }
+}
+
+void Dispatcher::open(const sockaddr_in &peer, uint64_t key, const Packet &syn) {
+    LOG_INFO << "new session from " << inet_ntoa(peer.sin_addr)
+             << ":" << ntohs(peer.sin_port) << std::endl;
+
+    auto source = opener();
+    if (source == nullptr) {
+        LOG_WARN << "nothing to send, client turned away" << std::endl;
+        return;
+    }
+
+    auto session = std::make_unique<Session>(s, peer, std::move(source));
+    session->transport.setPacketSize(HandshakeHelper::agree(syn));
+    if (!session->transport.send(PacketHelper::makePacket(PacketType::SYN_ACK, session->transport.packetSize()))) {
+        LOG_ERROR << "failed to send SYN_ACK to client" << std::endl;
+        return;
+    }
+
+    session->session = factory(session->transport, loop, session->rtt, *session->source);
+    session->session->start();
+    sessions.emplace(key, std::move(session));
+}
+
+ReliableStats Dispatcher::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return finished;
+}
+
+void Dispatcher::reap() {
+    auto now = loop.now();
+    for (auto it = closed.begin(); it != closed.end();) {
+        it = it->second <= now ? closed.erase(it) : std::next(it);
+    }
+
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        Session &session = *it->second;
+        if (!session.session->finished()) {
+            ++it;
+            continue;
+        }
+
+        LOG_INFO << "session of " << inet_ntoa(session.peer.sin_addr) << ":" << ntohs(session.peer.sin_port)
+                 << (session.session->succeeded() ? " done" : " failed")
+                 << ", srtt: " << session.rtt.srtt().count() << " ns"
+                 << ", stats: " << StatsHelper::toJson(session.stats.snapshot(session.rtt)) << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            StatsHelper::accumulate(finished, session.stats.snapshot(session.rtt));
+        }
+        RttEstimator::Duration timeWait = (std::max)(2 * session.rtt.rto(), RttEstimator::Duration(minTimeWait));
+        closed[it->first] = now + timeWait;
+        it = sessions.erase(it);
+    }
+}
+
+#ifdef __linux__
+
+void Dispatcher::drain() {
+    PacketPtr buffers[MAX_BATCH_SIZE];
+    iovec iovs[MAX_BATCH_SIZE];
+    sockaddr_in peers[MAX_BATCH_SIZE];
+    mmsghdr msgs[MAX_BATCH_SIZE];
+
+    // drain the socket, a full batch means there may be more
+    int result;
+    do {
+        for (int i = 0; i < MAX_BATCH_SIZE; i++) {
+            if (!buffers[i]) {
+                buffers[i] = PacketPool::allocate();
+            }
+            iovs[i].iov_base = buffers[i].get();
+            iovs[i].iov_len = MAX_PACKET_SIZE;
+            msgs[i] = {};
+            msgs[i].msg_hdr.msg_name = &peers[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        result = recvmmsg(s, msgs, MAX_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (result == SOCKET_ERROR) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR << "recvmmsg() failed: " << errno << std::endl;
+            }
+            return;
+        }
+
+        for (int i = 0; i < result; i++) {
+            uint32_t received = msgs[i].msg_len;
+            if (received < sizeof(Packet) || buffers[i]->len != received) {
+                continue;
+            }
+            dispatch(std::move(buffers[i]), peers[i]);
+        }
+    } while (result == MAX_BATCH_SIZE);
+}
+
+#else
+
+void Dispatcher::drain() {
+    // the loop saw it readable, so this does not block
+    auto packet = PacketPool::allocate();
+    sockaddr_in peer;
+    socklen_t peerLen = sizeof(peer);
+    int received = recvfrom(s, (char *) packet.get(), MAX_PACKET_SIZE, 0, (sockaddr *) &peer, &peerLen);
+    if (received == SOCKET_ERROR) {
+        LOG_ERROR << "recvfrom() failed: " << lastSocketError() << std::endl;
+        return;
+    }
+    if (received < sizeof(Packet) || packet->len != received) {
+        return;
+    }
+    dispatch(std::move(packet), peer);
+}
+
+#endif
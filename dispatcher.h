@@ -0,0 +1,96 @@
+#ifndef RELIABLE_OVER_UDP_DISPATCHER_H
+#define RELIABLE_OVER_UDP_DISPATCHER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "platform.h"
+#include "unreliable.h"
+#include "rtt_estimator.h"
+#include "reliable_stats.h"
+#include "stream.h"
+#include "session.h"
+#include "event_loop.h"
+
+// serves any number of clients on one UDP port, from one thread
+//
+// an event loop reads the socket (epoll + recvmmsg on linux) and hands
+// each datagram to the session of its peer address, a SYN from an unknown
+// peer opens a new session, every session is a state machine driven by
+// its packets and timers, all of them sending through the same socket
+//
+// a peer whose session was reaped stays closed for a while (like TCP's
+// TIME_WAIT), a late or duplicated SYN of it does not open another one
+class Dispatcher {
+public:
+    // builds the sending protocol of a new session
+    using Factory = std::function<std::unique_ptr<ISession>(ITransport &, ITimerService &,
+                                                            RttEstimator &, ISource &)>;
+    // what a new session sends, nullptr turns the client away
+    using Opener = std::function<std::unique_ptr<ISource>()>;
+
+private:
+    struct Session {
+        sockaddr_in peer;
+        Unreliable transport;
+        RttEstimator rtt;
+        // the dispatcher counts what it receives for the session, the transport what it sends
+        ConnectionStats stats;
+        std::unique_ptr<ISource> source;
+        // last, so it goes before what it refers to
+        std::unique_ptr<ISession> session;
+
+        Session(SOCKET s, const sockaddr_in &peer, std::unique_ptr<ISource> source)
+                : peer(peer), transport(s, peer, false), source(std::move(source)) {
+            transport.setStats(&stats);
+        }
+    };
+
+    SOCKET s;
+    Factory factory;
+    Opener opener;
+    EventLoop loop;
+    // keyed by peer address and port
+    std::unordered_map<uint64_t, std::unique_ptr<Session>> sessions;
+    // peers of reaped sessions, until when their SYNs are dropped
+    std::unordered_map<uint64_t, EventLoop::Clock::time_point> closed;
+
+    // the counters of every reaped session, summed
+    mutable std::mutex statsMutex;
+    ReliableStats finished;
+
+    // hand out everything queued on the socket
+    void drain();
+
+    void dispatch(PacketPtr packet, const sockaddr_in &peer);
+
+    void open(const sockaddr_in &peer, uint64_t key, const Packet &syn);
+
+    // drop the sessions which are finished, and forget peers closed long enough
+    void reap();
+
+public:
+    // with reusePort several dispatchers bind the same port, and the
+    // kernel spreads peers over them by address (SO_REUSEPORT)
+    Dispatcher(uint16_t port, Factory factory, Opener opener, bool reusePort = false);
+
+    ~Dispatcher();
+
+    Dispatcher(const Dispatcher &) = delete;
+
+    Dispatcher &operator=(const Dispatcher &) = delete;
+
+    // serve until stop() is called
+    void run();
+
+    // safe to call from any thread, run() returns shortly after
+    void stop();
+
+    // the counters of the sessions served so far, a session counts once it
+    // is reaped, safe to call from any thread
+    ReliableStats stats() const;
+};
+
+#endif //RELIABLE_OVER_UDP_DISPATCHER_H
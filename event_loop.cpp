@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <stdexcept>
+#include "log.h"
+#include "reliable_stats.h"
+#include "event_loop.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
+#ifdef __linux__
+
+EventLoop::EventLoop() {
+    epollFd = epoll_create1(0);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (epollFd == -1 || timerFd == -1 || wakeFd == -1) {
+        LOG_ERROR << "event loop setup failed: " << errno << std::endl;
+        throw std::runtime_error("event loop setup failed");
+    }
+
+    for (int fd: {timerFd, wakeFd}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+EventLoop::~EventLoop() {
+    close(wakeFd);
+    close(timerFd);
+    close(epollFd);
+}
+
+void EventLoop::watch(SOCKET s, Callback onReadable) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = s;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, s, &event) == -1) {
+        LOG_ERROR << "epoll_ctl() failed: " << errno << std::endl;
+        throw std::runtime_error("epoll_ctl() failed");
+    }
+    readers[s] = std::move(onReadable);
+}
+
+void EventLoop::unwatch(SOCKET s) {
+    if (readers.erase(s) > 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, s, nullptr);
+    }
+}
+
+void EventLoop::stop() {
+    stopping = true;
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) == -1) {
+        LOG_WARN << "failed to wake the event loop: " << errno << std::endl;
+    }
+}
+
+void EventLoop::wait() {
+    // the timerfd follows the earliest deadline, steady_clock is CLOCK_MONOTONIC
+    Clock::time_point earliest = deadlines.empty() ? Clock::time_point::max() : deadlines.top().when;
+    if (earliest != armedFor) {
+        itimerspec spec{};
+        if (earliest != Clock::time_point::max()) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(earliest.time_since_epoch()).count();
+            // a zero it_value disarms, a deadline in the past fires at once anyway
+            ns = (std::max)(ns, static_cast<decltype(ns)>(1));
+            spec.it_value.tv_sec = ns / 1000000000;
+            spec.it_value.tv_nsec = ns % 1000000000;
+        }
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+        armedFor = earliest;
+    }
+
+    epoll_event events[64];
+    int ready = epoll_wait(epollFd, events, 64, -1);
+    if (ready == -1) {
+        if (errno != EINTR) {
+            LOG_ERROR << "epoll_wait() failed: " << errno << std::endl;
+        }
+        return;
+    }
+
+    for (int i = 0; i < ready; i++) {
+        int fd = events[i].data.fd;
+        if (fd == timerFd || fd == wakeFd) {
+            uint64_t count;
+            if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                LOG_WARN << "read() failed: " << errno << std::endl;
+            }
+            if (fd == timerFd) {
+                armedFor = Clock::time_point::max();
+            }
+            continue;
+        }
+
+        // an earlier callback of this round may have unwatched it
+        auto it = readers.find(fd);
+        if (it != readers.end()) {
+            Callback callback = it->second;
+            callback();
+        }
+    }
+}
+
+#else
+
+// without epoll the loop looks at stop() at least this often
+const static auto maxSelectWait = std::chrono::milliseconds(100);
+
+EventLoop::EventLoop() = default;
+
+EventLoop::~EventLoop() = default;
+
+void EventLoop::watch(SOCKET s, Callback onReadable) {
+    readers[s] = std::move(onReadable);
+}
+
+void EventLoop::unwatch(SOCKET s) {
+    readers.erase(s);
+}
+
+void EventLoop::stop() {
+    stopping = true;
+}
+
+void EventLoop::wait() {
+    auto timeout = std::chrono::duration_cast<std::chrono::microseconds>(maxSelectWait);
+    if (!deadlines.empty()) {
+        auto untilDeadline = std::chrono::duration_cast<std::chrono::microseconds>(deadlines.top().when - now());
+        timeout = std::clamp(untilDeadline, std::chrono::microseconds::zero(), timeout);
+    }
+    timeval tv{static_cast<long>(timeout.count() / 1000000), static_cast<long>(timeout.count() % 1000000)};
+
+    fd_set readable;
+    FD_ZERO(&readable);
+    SOCKET highest = 0;
+    for (auto &[s, callback]: readers) {
+        FD_SET(s, &readable);
+        highest = (std::max)(highest, s);
+    }
+
+    int ready = select(static_cast<int>(highest) + 1, &readable, nullptr, nullptr, &tv);
+    if (ready == SOCKET_ERROR) {
+        LOG_ERROR << "select() failed: " << lastSocketError() << std::endl;
+        return;
+    }
+    if (ready == 0) {
+        return;
+    }
+
+    std::vector<SOCKET> sockets;
+    for (auto &[s, callback]: readers) {
+        if (FD_ISSET(s, &readable)) {
+            sockets.push_back(s);
+        }
+    }
+    for (SOCKET s: sockets) {
+        auto it = readers.find(s);
+        if (it != readers.end()) {
+            Callback callback = it->second;
+            callback();
+        }
+    }
+}
+
+#endif
+
+ITimerService::TimerId EventLoop::schedule(Clock::time_point when, std::function<void()> callback) {
+    TimerId id = ++lastId;
+    deadlines.push({when, id});
+    callbacks.emplace(id, std::move(callback));
+    return id;
+}
+
+void EventLoop::cancel(TimerId id) {
+    callbacks.erase(id);
+}
+
+void EventLoop::fireTimers() {
+    auto current = now();
+    while (!deadlines.empty()) {
+        Deadline top = deadlines.top();
+        auto it = callbacks.find(top.id);
+        if (it == callbacks.end()) {
+            deadlines.pop(); // cancelled
+            continue;
+        }
+        if (top.when > current) {
+            break;
+        }
+
+        deadlines.pop();
+        Callback callback = std::move(it->second);
+        callbacks.erase(it);
+        callback();
+    }
+}
+
+void EventLoop::run(const std::function<bool()> &done) {
+    while (!stopping.load()) {
+        fireTimers();
+        if (done && done()) {
+            break;
+        }
+        wait();
+    }
+}
+
+void SessionHelper::deliver(Unreliable &unreliable, ISession &session, std::vector<PacketPtr> &packets) {
+    // a full batch may leave more behind
+    int count;
+    do {
+        packets.clear();
+        count = unreliable.recv(packets, EventLoop::Clock::duration::zero());
+        for (auto &packet: packets) {
+            if (session.finished()) {
+                continue;
+            }
+            if (!PacketHelper::isValidPacket(packet)) {
+                if (ConnectionStats *stats = unreliable.stats()) {
+                    stats->checksumFailed();
+                }
+                continue;
+            }
+            session.onPacket(std::move(packet));
+        }
+    } while (count >= MAX_BATCH_SIZE && !session.finished());
+}
+
+void SessionHelper::run(EventLoop &loop, Unreliable &unreliable, ISession &session) {
+    std::vector<PacketPtr> packets;
+    loop.watch(unreliable.socket(), [&] { deliver(unreliable, session, packets); });
+
+    session.start();
+    loop.run([&session] { return session.finished(); });
+    loop.unwatch(unreliable.socket());
+}
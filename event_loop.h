@@ -0,0 +1,95 @@
+#ifndef RELIABLE_OVER_UDP_EVENT_LOOP_H
+#define RELIABLE_OVER_UDP_EVENT_LOOP_H
+
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "platform.h"
+#include "session.h"
+#include "unreliable.h"
+
+// single threaded reactor: readable sockets and timers, epoll + timerfd on
+// linux, select elsewhere
+//
+// every callback runs on the thread inside run(), and may watch, schedule
+// or cancel freely, only stop() is meant for other threads
+class EventLoop : public ITimerService {
+public:
+    using Callback = std::function<void()>;
+
+private:
+    struct Deadline {
+        Clock::time_point when;
+        TimerId id;
+
+        bool operator>(const Deadline &other) const {
+            return when > other.when;
+        }
+    };
+
+    std::unordered_map<SOCKET, Callback> readers;
+
+    // a cancelled timer only leaves callbacks, its deadline is dropped when it pops
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines;
+    std::unordered_map<TimerId, Callback> callbacks;
+    TimerId lastId = 0;
+
+    std::atomic<bool> stopping = false;
+
+#ifdef __linux__
+    int epollFd = -1;
+    int timerFd = -1;
+    int wakeFd = -1;
+    // what timerFd is armed for, max() when disarmed
+    Clock::time_point armedFor = Clock::time_point::max();
+#endif
+
+    // wait for the next event, at most until the earliest deadline
+    void wait();
+
+    // run every callback which is due
+    void fireTimers();
+
+public:
+    EventLoop();
+
+    ~EventLoop() override;
+
+    EventLoop(const EventLoop &) = delete;
+
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // onReadable runs whenever s has data queued
+    void watch(SOCKET s, Callback onReadable);
+
+    void unwatch(SOCKET s);
+
+    Clock::time_point now() const override {
+        return Clock::now();
+    }
+
+    TimerId schedule(Clock::time_point when, std::function<void()> callback) override;
+
+    void cancel(TimerId id) override;
+
+    // handle events until done() returns true, it is asked after every
+    // round of events, or until stop() is called
+    void run(const std::function<bool()> &done = nullptr);
+
+    // safe to call from any thread, run() returns shortly after
+    void stop();
+};
+
+namespace SessionHelper {
+    // hand what is queued on the socket of unreliable to session, without
+    // blocking, until the socket is empty or the session finished
+    void deliver(Unreliable &unreliable, ISession &session, std::vector<PacketPtr> &packets);
+
+    // drive one session over its own socket until it finishes,
+    // on a loop nobody else uses
+    void run(EventLoop &loop, Unreliable &unreliable, ISession &session);
+}
+
+#endif //RELIABLE_OVER_UDP_EVENT_LOOP_H
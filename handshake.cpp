@@ -0,0 +1,89 @@
+#include <algorithm>
+#include "log.h"
+#include "handshake.h"
+
+// the SYN is resent when no SYN_ACK arrives in time
+const static auto synTimeout = std::chrono::milliseconds(1000);
+const static int synRetries = 5;
+// a probe too large for the path is not answered at all, so give up on
+// a size sooner, but twice, a probe may just be lost
+const static auto probeTimeout = std::chrono::milliseconds(300);
+const static int probeRetries = 2;
+
+// IPv4 + UDP headers
+const static uint32_t ipUdpHeaders = 20 + 8;
+// the usual link MTUs, largest first (jumbo, FDDI, ethernet, PPPoE, IPv6 minimum)
+const static uint32_t plateaus[] = {9000, 4352, 1500, 1492, 1280};
+
+std::vector<HandshakeHelper::Attempt> HandshakeHelper::schedule(uint32_t packetSize, bool probe) {
+    packetSize = std::clamp<uint32_t>(packetSize, MIN_PACKET_SIZE, MAX_PACKET_SIZE);
+
+    std::vector<Attempt> attempts;
+    if (probe) {
+        std::vector<uint32_t> sizes{packetSize};
+        for (uint32_t mtu: plateaus) {
+            uint32_t size = mtu - ipUdpHeaders;
+            if (size < sizes.back() && size > MIN_PACKET_SIZE) {
+                sizes.push_back(size);
+            }
+        }
+        for (uint32_t size: sizes) {
+            if (size == MIN_PACKET_SIZE) {
+                break;
+            }
+            for (int i = 0; i < probeRetries; i++) {
+                attempts.push_back({size, probeTimeout});
+            }
+        }
+        // whatever happens, the smallest size is tried as long as without probing
+        packetSize = MIN_PACKET_SIZE;
+    }
+    for (int i = 0; i < synRetries; i++) {
+        attempts.push_back({packetSize, synTimeout});
+    }
+    return attempts;
+}
+
+PacketPtr HandshakeHelper::makeSyn(uint32_t packetSize, bool probe) {
+    if (!probe) {
+        return PacketHelper::makePacket(PacketType::SYN, packetSize);
+    }
+    const static uint8_t padding[MAX_PACKET_SIZE] = {};
+    return PacketHelper::makePacket(PacketType::SYN, packetSize, padding, packetSize - sizeof(Packet));
+}
+
+uint32_t HandshakeHelper::agree(const Packet &syn, uint32_t limit) {
+    uint32_t proposed = syn.num == 0 ? MAX_PACKET_SIZE : syn.num;
+    return std::clamp<uint32_t>((std::min)(proposed, limit), MIN_PACKET_SIZE, MAX_PACKET_SIZE);
+}
+
+uint32_t HandshakeHelper::agreed(const Packet &synAck, uint32_t proposed) {
+    // a server which does not negotiate sends what it always did
+    if (synAck.num == 0) {
+        return MAX_PACKET_SIZE;
+    }
+    uint32_t size = synAck.num;
+    if (size < MIN_PACKET_SIZE || size > proposed) {
+        LOG_WARN << "server agreed to a packet size never proposed: " << size << std::endl;
+        return 0;
+    }
+    return size;
+}
+
+bool HandshakeHelper::setDontFragment(SOCKET s, bool enable) {
+#if defined(__linux__)
+    // PROBE sets DF but ignores the path MTU the kernel cached, the probe finds it itself
+    int value = enable ? IP_PMTUDISC_PROBE : IP_PMTUDISC_WANT;
+    int result = setsockopt(s, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value));
+#elif defined(_WIN32)
+    DWORD value = enable ? 1 : 0;
+    int result = setsockopt(s, IPPROTO_IP, IP_DONTFRAGMENT, (const char *) &value, sizeof(value));
+#else
+    int result = SOCKET_ERROR;
+#endif
+    if (result == SOCKET_ERROR) {
+        LOG_WARN << "failed to set the DF bit: " << lastSocketError() << std::endl;
+        return false;
+    }
+    return true;
+}
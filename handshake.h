@@ -0,0 +1,42 @@
+#ifndef RELIABLE_OVER_UDP_HANDSHAKE_H
+#define RELIABLE_OVER_UDP_HANDSHAKE_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "platform.h"
+#include "packet.h"
+
+// the packet size is agreed in the handshake: the SYN proposes one in
+// num, the SYN_ACK answers the agreed one in num, a SYN with num 0 comes
+// from a peer which predates this and gets MAX_PACKET_SIZE
+//
+// when probing, the client sends its SYNs with the DF bit set and padded
+// to the size they propose, from the largest size down, so the first
+// one answered is the largest the path carries without fragmenting
+// (the path back is assumed to carry the same)
+namespace HandshakeHelper {
+
+    // one SYN of the client: its size, and how long to wait for SYN_ACK
+    struct Attempt {
+        uint32_t packetSize;
+        std::chrono::milliseconds timeout;
+    };
+
+    // every SYN the client sends until one is answered, in order
+    std::vector<Attempt> schedule(uint32_t packetSize, bool probe);
+
+    // a SYN proposing packetSize, padded to it when probing
+    PacketPtr makeSyn(uint32_t packetSize, bool probe);
+
+    // the packet size the server agrees to for syn, at most limit
+    uint32_t agree(const Packet &syn, uint32_t limit = MAX_PACKET_SIZE);
+
+    // the packet size a SYN_ACK agreed to, 0 if it is none the client can use
+    uint32_t agreed(const Packet &synAck, uint32_t proposed);
+
+    // set the DF bit on everything s sends, or go back to the default
+    bool setDontFragment(SOCKET s, bool enable);
+}
+
+#endif //RELIABLE_OVER_UDP_HANDSHAKE_H
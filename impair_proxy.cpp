@@ -0,0 +1,207 @@
+#include <stdexcept>
+#include "log.h"
+#include "impair_proxy.h"
+
+// room for a whole offloaded batch, and for bursts the link queues up
+const static int socketBufferSize = 8 * 1024 * 1024;
+const static size_t maxDatagramSize = 65536;
+
+static uint64_t peerKey(const sockaddr_in &peer) {
+    return (static_cast<uint64_t>(peer.sin_addr.s_addr) << 16) | peer.sin_port;
+}
+
+static SOCKET openSocket(uint16_t port) {
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        LOG_ERROR << "socket() failed: " << lastSocketError() << std::endl;
+        throw std::runtime_error("socket() failed");
+    }
+
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char *) &socketBufferSize, sizeof(socketBufferSize));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char *) &socketBufferSize, sizeof(socketBufferSize));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(s, (sockaddr *) &addr, sizeof(addr)) == SOCKET_ERROR) {
+        LOG_ERROR << "bind() failed: " << lastSocketError() << std::endl;
+        closesocket(s);
+        throw std::runtime_error("bind() failed");
+    }
+    return s;
+}
+
+static void add(Impairment::Counters &sum, const Impairment::Counters &counters) {
+    sum.datagrams += counters.datagrams;
+    sum.bytes += counters.bytes;
+    sum.lost += counters.lost;
+    sum.burstLost += counters.burstLost;
+    sum.queueDropped += counters.queueDropped;
+    sum.duplicated += counters.duplicated;
+    sum.reordered += counters.reordered;
+}
+
+static void print(std::ostream &out, const char *direction, const Impairment::Counters &counters) {
+    out << direction << ": " << counters.datagrams << " datagrams, " << counters.bytes << " bytes, "
+        << counters.lost << " lost, " << counters.burstLost << " lost in bursts, "
+        << counters.queueDropped << " dropped by the queue, " << counters.reordered << " reordered, "
+        << counters.duplicated << " duplicated" << std::endl;
+}
+
+ImpairProxy::ImpairProxy(uint16_t listenPort, const std::string &serverIp, uint16_t serverPort,
+                         const ImpairmentConfig &forward, const ImpairmentConfig &backward)
+        : forwardConfig(forward), backwardConfig(backward), buffer(maxDatagramSize) {
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(serverPort);
+    serverAddr.sin_addr.s_addr = inet_addr(serverIp.c_str());
+
+    s = openSocket(listenPort);
+    loop.watch(s, [this] { fromClient(); });
+}
+
+ImpairProxy::~ImpairProxy() {
+    loop.cancel(timer);
+    for (auto &[key, client]: clients) {
+        loop.unwatch(client->upstream);
+        closesocket(client->upstream);
+    }
+    loop.unwatch(s);
+    closesocket(s);
+}
+
+void ImpairProxy::run() {
+    LOG_INFO << "relaying to " << inet_ntoa(serverAddr.sin_addr) << ":" << ntohs(serverAddr.sin_port) << std::endl;
+    loop.run();
+}
+
+void ImpairProxy::stop() {
+    loop.stop();
+}
+
+ImpairProxy::Client &ImpairProxy::clientOf(const sockaddr_in &peer) {
+    uint64_t key = peerKey(peer);
+    auto it = clients.find(key);
+    if (it != clients.end()) {
+        return *it->second;
+    }
+
+    LOG_INFO << "new client " << inet_ntoa(peer.sin_addr) << ":" << ntohs(peer.sin_port) << std::endl;
+
+    // every client its own random sequences, the same ones on every run
+    uint64_t index = clients.size();
+    ImpairmentConfig forward = forwardConfig;
+    ImpairmentConfig backward = backwardConfig;
+    forward.seed = forwardConfig.seed + 2 * index;
+    backward.seed = backwardConfig.seed + 2 * index + 1;
+
+    auto client = std::make_unique<Client>(Client{peer, openSocket(0), Impairment(forward), Impairment(backward)});
+    Client &ref = *client;
+    loop.watch(ref.upstream, [this, &ref] { fromServer(ref); });
+    clients.emplace(key, std::move(client));
+    return ref;
+}
+
+// the loop saw the socket readable, so one recvfrom does not block, and
+// what is left makes it readable again
+
+void ImpairProxy::fromClient() {
+    sockaddr_in peer{};
+    socklen_t peerLen = sizeof(peer);
+    int received = recvfrom(s, (char *) buffer.data(), static_cast<int>(buffer.size()), 0,
+                            (sockaddr *) &peer, &peerLen);
+    if (received == SOCKET_ERROR) {
+        LOG_ERROR << "recvfrom() failed: " << lastSocketError() << std::endl;
+        return;
+    }
+
+    Client &client = clientOf(peer);
+    relay(client.forward, "forward", client.upstream, serverAddr, received);
+}
+
+void ImpairProxy::fromServer(Client &client) {
+    sockaddr_in peer{};
+    socklen_t peerLen = sizeof(peer);
+    int received = recvfrom(client.upstream, (char *) buffer.data(), static_cast<int>(buffer.size()), 0,
+                            (sockaddr *) &peer, &peerLen);
+    if (received == SOCKET_ERROR) {
+        LOG_ERROR << "recvfrom() failed: " << lastSocketError() << std::endl;
+        return;
+    }
+
+    relay(client.backward, "backward", s, client.peer, received);
+}
+
+void ImpairProxy::relay(Impairment &impairment, const char *direction, SOCKET from, const sockaddr_in &to,
+                        uint32_t len) {
+    auto now = loop.now();
+    auto verdict = impairment.pass(now, len);
+    LOG_DEBUG << direction << " " << len << " bytes: " << Impairment::name(verdict.fate)
+              << (verdict.reordered ? ", reordered" : "") << (verdict.copies > 1 ? ", duplicated" : "")
+              << std::endl;
+    if (verdict.copies == 0) {
+        return;
+    }
+
+    auto data = std::make_shared<std::vector<uint8_t>>(buffer.begin(), buffer.begin() + len);
+    for (int i = 0; i < verdict.copies; i++) {
+        pending.push({verdict.arrival[i], lastOrder++, from, to, data});
+    }
+    flush();
+}
+
+void ImpairProxy::flush() {
+    auto now = loop.now();
+    while (!pending.empty() && pending.top().when <= now) {
+        const Pending &datagram = pending.top();
+        if (sendto(datagram.from, (const char *) datagram.data->data(), static_cast<int>(datagram.data->size()), 0,
+                   (const sockaddr *) &datagram.to, sizeof(datagram.to)) == SOCKET_ERROR) {
+            LOG_WARN << "sendto() failed: " << lastSocketError() << std::endl;
+        }
+        pending.pop();
+    }
+    armTimer();
+}
+
+void ImpairProxy::armTimer() {
+    Clock::time_point earliest = pending.empty() ? Clock::time_point::max() : pending.top().when;
+    if (earliest == armedFor) {
+        return;
+    }
+
+    loop.cancel(timer);
+    timer = 0;
+    armedFor = earliest;
+    if (earliest != Clock::time_point::max()) {
+        timer = loop.schedule(earliest, [this] {
+            timer = 0;
+            armedFor = Clock::time_point::max();
+            flush();
+        });
+    }
+}
+
+Impairment::Counters ImpairProxy::forwardCounters() const {
+    Impairment::Counters sum;
+    for (auto &[key, client]: clients) {
+        add(sum, client->forward.counters());
+    }
+    return sum;
+}
+
+Impairment::Counters ImpairProxy::backwardCounters() const {
+    Impairment::Counters sum;
+    for (auto &[key, client]: clients) {
+        add(sum, client->backward.counters());
+    }
+    return sum;
+}
+
+void ImpairProxy::report(std::ostream &out) const {
+    out << "forward link: " << forwardConfig.describe() << std::endl;
+    out << "backward link: " << backwardConfig.describe() << std::endl;
+    out << clients.size() << " clients" << std::endl;
+    print(out, "forward", forwardCounters());
+    print(out, "backward", backwardCounters());
+}
@@ -0,0 +1,103 @@
+#ifndef RELIABLE_OVER_UDP_IMPAIR_PROXY_H
+#define RELIABLE_OVER_UDP_IMPAIR_PROXY_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "platform.h"
+#include "event_loop.h"
+#include "impairment.h"
+
+// a UDP relay which behaves like a bad link, for benchmarks on loopback
+//
+// clients talk to the listen port, every client gets its own upstream
+// socket towards the server, so the server tells them apart as usual,
+// each direction of each client crosses its own Impairment, client i
+// seeded with seed + 2i forward and seed + 2i + 1 backward
+class ImpairProxy {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Client {
+        sockaddr_in peer;
+        SOCKET upstream;
+        Impairment forward;
+        Impairment backward;
+    };
+
+    // a datagram on its way, copies of a duplicate share the data
+    struct Pending {
+        Clock::time_point when;
+        // keeps the order of what is due at the same time
+        uint64_t order;
+        SOCKET from;
+        sockaddr_in to;
+        std::shared_ptr<std::vector<uint8_t>> data;
+
+        bool operator>(const Pending &other) const {
+            return when != other.when ? when > other.when : order > other.order;
+        }
+    };
+
+    SOCKET s;
+    sockaddr_in serverAddr{};
+    ImpairmentConfig forwardConfig;
+    ImpairmentConfig backwardConfig;
+    EventLoop loop;
+    // keyed by client address and port
+    std::unordered_map<uint64_t, std::unique_ptr<Client>> clients;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending;
+    uint64_t lastOrder = 0;
+    ITimerService::TimerId timer = 0;
+    // what timer is armed for, max() when disarmed
+    Clock::time_point armedFor = Clock::time_point::max();
+    std::vector<uint8_t> buffer;
+
+    // a datagram from a client, on the listen socket
+    void fromClient();
+
+    // a datagram from the server, on the upstream socket of client
+    void fromServer(Client &client);
+
+    Client &clientOf(const sockaddr_in &peer);
+
+    void relay(Impairment &impairment, const char *direction, SOCKET from, const sockaddr_in &to,
+               uint32_t len);
+
+    // send what is due and wait for the next
+    void flush();
+
+    void armTimer();
+
+public:
+    // backward impairs what the server sends, forward what it receives
+    ImpairProxy(uint16_t listenPort, const std::string &serverIp, uint16_t serverPort,
+                const ImpairmentConfig &forward, const ImpairmentConfig &backward);
+
+    ~ImpairProxy();
+
+    ImpairProxy(const ImpairProxy &) = delete;
+
+    ImpairProxy &operator=(const ImpairProxy &) = delete;
+
+    // relay until stop() is called
+    void run();
+
+    // safe to call from any thread
+    void stop();
+
+    // the counters of every client, per direction
+    Impairment::Counters forwardCounters() const;
+
+    Impairment::Counters backwardCounters() const;
+
+    // the configuration and what happened, for the log of a run
+    void report(std::ostream &out) const;
+};
+
+#endif //RELIABLE_OVER_UDP_IMPAIR_PROXY_H
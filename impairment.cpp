@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <sstream>
+#include "impairment.h"
+
+using Seconds = std::chrono::duration<double>;
+using Millis = std::chrono::duration<double, std::milli>;
+
+std::string ImpairmentConfig::describe() const {
+    std::ostringstream out;
+    out << "loss " << loss
+        << ", burst " << burstEnter << "/" << burstExit << "/" << burstLoss
+        << ", delay " << Millis(delay).count() << " ms"
+        << ", jitter " << Millis(jitter).count() << " ms"
+        << ", reorder " << reorder << " by " << Millis(reorderDelay).count() << " ms"
+        << ", duplicate " << duplicate
+        << ", rate " << rate << " B/s"
+        << ", queue " << queueLimit << " B"
+        << ", seed " << seed;
+    return out.str();
+}
+
+Impairment::Impairment(const ImpairmentConfig &config)
+        : cfg(config), rng(config.seed) {}
+
+const char *Impairment::name(Fate fate) {
+    switch (fate) {
+        case Fate::DELIVERED:
+            return "delivered";
+        case Fate::LOST:
+            return "lost";
+        case Fate::BURST_LOST:
+            return "lost in burst";
+        case Fate::QUEUE_FULL:
+            return "queue full";
+    }
+    return "unknown";
+}
+
+bool Impairment::chance(double p) {
+    // no draw for what is off, so turning one knob keeps the others' sequence
+    if (p <= 0) {
+        return false;
+    }
+    return uniform(rng) < p;
+}
+
+Impairment::Clock::duration Impairment::propagation() {
+    auto delay = std::chrono::duration_cast<Clock::duration>(cfg.delay);
+    if (cfg.jitter > ImpairmentConfig::Duration::zero()) {
+        double offset = (uniform(rng) * 2 - 1) * static_cast<double>(cfg.jitter.count());
+        delay += std::chrono::duration_cast<Clock::duration>(ImpairmentConfig::Duration(
+                static_cast<ImpairmentConfig::Duration::rep>(offset)));
+    }
+    return (std::max)(delay, Clock::duration::zero());
+}
+
+Impairment::Verdict Impairment::pass(Clock::time_point now, uint32_t len) {
+    Verdict verdict{Fate::DELIVERED, 0, {}, false};
+    stats.datagrams++;
+    stats.bytes += len;
+
+    // the burst state moves once per datagram, before anything is decided
+    if (cfg.burstEnter > 0) {
+        bad = bad ? !chance(cfg.burstExit) : chance(cfg.burstEnter);
+    }
+    if (bad && chance(cfg.burstLoss)) {
+        stats.burstLost++;
+        verdict.fate = Fate::BURST_LOST;
+        return verdict;
+    }
+    if (chance(cfg.loss)) {
+        stats.lost++;
+        verdict.fate = Fate::LOST;
+        return verdict;
+    }
+
+    // the bottleneck sends one datagram after the other, what waits for it
+    // is the backlog, which the queue limit bounds
+    Clock::time_point sent = now;
+    if (cfg.rate > 0) {
+        Clock::time_point start = (std::max)(now, busyUntil);
+        auto backlog = static_cast<uint64_t>(Seconds(start - now).count() * static_cast<double>(cfg.rate));
+        if (backlog + len > cfg.queueLimit) {
+            stats.queueDropped++;
+            verdict.fate = Fate::QUEUE_FULL;
+            return verdict;
+        }
+        busyUntil = start + std::chrono::duration_cast<Clock::duration>(
+                Seconds(static_cast<double>(len) / static_cast<double>(cfg.rate)));
+        sent = busyUntil;
+    }
+
+    Clock::time_point arrival = sent + propagation();
+    if (chance(cfg.reorder)) {
+        stats.reordered++;
+        verdict.reordered = true;
+        arrival += std::chrono::duration_cast<Clock::duration>(cfg.reorderDelay);
+    }
+
+    verdict.arrival[verdict.copies++] = arrival;
+    if (chance(cfg.duplicate)) {
+        stats.duplicated++;
+        verdict.arrival[verdict.copies++] = sent + propagation();
+    }
+    return verdict;
+}
@@ -0,0 +1,103 @@
+#ifndef RELIABLE_OVER_UDP_IMPAIRMENT_H
+#define RELIABLE_OVER_UDP_IMPAIRMENT_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+
+// what a link does to the datagrams crossing it, one direction
+struct ImpairmentConfig {
+    using Duration = std::chrono::nanoseconds;
+
+    // random loss, of every datagram
+    double loss = 0;
+    // Gilbert-Elliott bursts: the link turns bad with burstEnter per
+    // datagram, good again with burstExit, and while bad it loses burstLoss
+    double burstEnter = 0;
+    double burstExit = 1;
+    double burstLoss = 1;
+
+    // one way delay, each datagram is off by up to +-jitter from it
+    Duration delay{};
+    Duration jitter{};
+
+    // this share of the datagrams is held back by reorderDelay more
+    double reorder = 0;
+    Duration reorderDelay = std::chrono::milliseconds(1);
+
+    double duplicate = 0;
+
+    // bytes per second the link carries, 0 for no cap, datagrams which
+    // find queueLimit bytes waiting in front of them are dropped
+    uint64_t rate = 0;
+    uint64_t queueLimit = 256 * 1024;
+
+    // the same seed gives the same decisions for the same datagrams
+    uint64_t seed = 1;
+
+    // one line, to log with the results of a run
+    std::string describe() const;
+};
+
+// the link model, it only decides, whoever moves the datagrams asks it
+// for each one when it would arrive, on a real clock or a virtual one
+class Impairment {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Fate {
+        DELIVERED,
+        LOST,
+        BURST_LOST,
+        QUEUE_FULL,
+    };
+
+    struct Verdict {
+        Fate fate;
+        // copies which arrive, 2 for a duplicate, 0 unless DELIVERED
+        int copies;
+        Clock::time_point arrival[2];
+        bool reordered;
+    };
+
+    struct Counters {
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        uint64_t lost = 0;
+        uint64_t burstLost = 0;
+        uint64_t queueDropped = 0;
+        uint64_t duplicated = 0;
+        uint64_t reordered = 0;
+    };
+
+    explicit Impairment(const ImpairmentConfig &config);
+
+    static const char *name(Fate fate);
+
+    // a datagram of len bytes enters the link at now
+    Verdict pass(Clock::time_point now, uint32_t len);
+
+    const ImpairmentConfig &config() const {
+        return cfg;
+    }
+
+    const Counters &counters() const {
+        return stats;
+    }
+
+private:
+    ImpairmentConfig cfg;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> uniform{0, 1};
+    bool bad = false;
+    // when the link has sent what is queued so far
+    Clock::time_point busyUntil;
+    Counters stats;
+
+    bool chance(double p);
+
+    Clock::duration propagation();
+};
+
+#endif //RELIABLE_OVER_UDP_IMPAIRMENT_H
@@ -0,0 +1,226 @@
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <string_view>
+#include <streambuf>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "log.h"
+
+const static uint32_t ringSlots = 256; // power of 2
+const static uint32_t lineSize = 240;
+// lines a thread may be formatting at once, one inside another (an argument
+// of a line which logs itself), deeper ones are dropped
+const static int maxDepth = 4;
+const static auto drainInterval = std::chrono::milliseconds(2);
+
+namespace {
+    struct Slot {
+        uint32_t len;
+        char text[lineSize];
+    };
+
+    // single producer (the owning thread), single consumer (whoever holds drainMutex)
+    struct Ring {
+        Slot slots[ringSlots];
+        std::atomic<uint32_t> head = 0; // next slot to write
+        std::atomic<uint32_t> tail = 0; // next slot to read
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<bool> closed = false;
+    };
+
+    // formats straight into a fixed buffer, whatever does not fit is cut
+    class LineBuf : public std::streambuf {
+    public:
+        char buf[lineSize];
+
+        void reset() {
+            setp(buf, buf + lineSize - 1); // room for the final newline
+        }
+
+        uint32_t size() const {
+            return static_cast<uint32_t>(pptr() - pbase());
+        }
+
+    protected:
+        int_type overflow(int_type) override {
+            return traits_type::eof();
+        }
+    };
+
+    struct Logger {
+        std::mutex registryMutex;
+        std::vector<std::shared_ptr<Ring>> rings;
+
+        std::mutex drainMutex;
+        std::atomic<bool> stopping = false;
+        std::thread drainer;
+
+        Logger() {
+            drainer = std::thread([this] {
+                while (!stopping.load()) {
+                    std::this_thread::sleep_for(drainInterval);
+                    drain();
+                }
+            });
+        }
+
+        ~Logger() {
+            stopping = true;
+            drainer.join();
+            drain();
+        }
+
+        std::shared_ptr<Ring> attach() {
+            auto ring = std::make_shared<Ring>();
+            std::lock_guard lock(registryMutex);
+            rings.push_back(ring);
+            return ring;
+        }
+
+        void drain() {
+            std::lock_guard drainLock(drainMutex);
+
+            std::vector<std::shared_ptr<Ring>> snapshot;
+            {
+                std::lock_guard lock(registryMutex);
+                // threads which are gone and fully written out
+                std::erase_if(rings, [](const std::shared_ptr<Ring> &ring) {
+                    return ring->closed.load() &&
+                           ring->tail.load() == ring->head.load(std::memory_order_acquire);
+                });
+                snapshot = rings;
+            }
+
+            bool wrote = false;
+            for (auto &ring: snapshot) {
+                uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+                uint32_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; tail++) {
+                    const Slot &slot = ring->slots[tail % ringSlots];
+                    fwrite(slot.text, 1, slot.len, stdout);
+                    wrote = true;
+                }
+                ring->tail.store(tail, std::memory_order_release);
+
+                if (uint64_t dropped = ring->dropped.exchange(0)) {
+                    fprintf(stdout, "[log] ring full or lines nested too deep, %llu lines dropped\n",
+                            static_cast<unsigned long long>(dropped));
+                    wrote = true;
+                }
+            }
+
+            if (wrote) {
+                fflush(stdout);
+            }
+        }
+    };
+
+    Logger &logger() {
+        static Logger instance;
+        return instance;
+    }
+
+    struct Frame {
+        LineBuf buf;
+        std::ostream os{&buf};
+    };
+
+    struct ThreadState {
+        // the buffers of the lines being formatted, innermost last
+        Frame frames[maxDepth];
+        int depth = 0;
+        // with no streambuf, whatever goes in is thrown away
+        std::ostream discard{nullptr};
+        std::shared_ptr<Ring> ring;
+
+        ~ThreadState() {
+            if (ring) {
+                ring->closed = true;
+            }
+        }
+    };
+
+    thread_local ThreadState state;
+
+    LogLevel levelFromEnv() {
+        const char *env = std::getenv("RELIABLE_LOG_LEVEL");
+        if (env == nullptr) {
+            return LogLevel::INFO;
+        }
+
+        std::string_view name(env);
+        if (name == "trace") return LogLevel::TRACE;
+        if (name == "debug") return LogLevel::DEBUG;
+        if (name == "info") return LogLevel::INFO;
+        if (name == "warn") return LogLevel::WARN;
+        if (name == "error") return LogLevel::ERR;
+        if (name == "off") return LogLevel::OFF;
+        return LogLevel::INFO;
+    }
+}
+
+std::atomic<LogLevel> Log::runtimeLevel = levelFromEnv();
+
+void Log::setLevel(LogLevel level) {
+    runtimeLevel.store(level, std::memory_order_relaxed);
+}
+
+void Log::flush() {
+    logger().drain();
+}
+
+// the buffer of a new line, a line logged while another one is being
+// formatted gets the next one, so it does not overwrite the outer line
+static std::ostream &claim() {
+    if (state.depth == maxDepth) {
+        return state.discard;
+    }
+    Frame &frame = state.frames[state.depth++];
+    frame.buf.reset();
+    frame.os.clear();
+    return frame.os;
+}
+
+Log::Line::Line(LogLevel level, const char *function)
+        : level(level), os(claim()) {
+    os << "[" << std::left << std::setw(50) << function << std::right << "] ";
+}
+
+Log::Line::~Line() {
+    if (!state.ring) {
+        state.ring = logger().attach();
+    }
+    Ring &ring = *state.ring;
+
+    if (os.rdbuf() == nullptr) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // lines end in the reverse order they began
+    LineBuf &buf = state.frames[--state.depth].buf;
+    uint32_t len = buf.size();
+    if (len == 0 || buf.buf[len - 1] != '\n') {
+        buf.buf[len++] = '\n';
+    }
+
+    // never block the caller, drop the line when the drainer falls behind
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= ringSlots) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        Slot &slot = ring.slots[head % ringSlots];
+        memcpy(slot.text, buf.buf, len);
+        slot.len = len;
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    // errors usually come right before the process gives up, get them out now
+    if (level >= LogLevel::ERR) {
+        flush();
+    }
+}
@@ -2,10 +2,88 @@
 #define RELIABLE_OVER_UDP_LOG_H
 
 #include <iostream>
-#include <syncstream>
 #include <iomanip>
+#include <atomic>
+#include <cstdint>
 
-#define LOG (std::osyncstream(std::cout) << \
-            "[" << std::left << std::setw(50) <<__FUNCTION__ << std::right << "] ")
+// leveled logging
+//
+// LOG_TRACE << "sent packet " << seq << std::endl;
+//
+// levels below LOG_COMPILED_LEVEL compile to nothing (release builds
+// drop TRACE), the rest is filtered by the runtime level, which comes
+// from RELIABLE_LOG_LEVEL (trace/debug/info/warn/error/off) or
+// Log::setLevel(). a line is formatted into the calling thread's own
+// lock-free ring buffer, a background thread writes the rings to stdout
+
+enum class LogLevel : uint8_t {
+    TRACE,
+    DEBUG,
+    INFO,
+    WARN,
+    ERR,
+    OFF,
+};
+
+#ifndef LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILED_LEVEL 1
+#else
+#define LOG_COMPILED_LEVEL 0
+#endif
+#endif
+
+namespace Log {
+    extern std::atomic<LogLevel> runtimeLevel;
+
+    void setLevel(LogLevel level);
+
+    // block until every line logged so far has been written
+    void flush();
+
+    constexpr bool compiled(LogLevel level) {
+        return level >= static_cast<LogLevel>(LOG_COMPILED_LEVEL);
+    }
+
+    inline bool enabled(LogLevel level) {
+        return compiled(level) && level >= runtimeLevel.load(std::memory_order_relaxed);
+    }
+
+    // one log line, formatted into a buffer of its own (one of a few per
+    // thread, a line may log another one while it is formatted)
+    // and queued when it goes out of scope
+    class Line {
+        LogLevel level;
+        std::ostream &os;
+    public:
+        Line(LogLevel level, const char *function);
+
+        ~Line();
+
+        Line(const Line &) = delete;
+
+        Line &operator=(const Line &) = delete;
+
+        template <typename T>
+        Line &operator<<(const T &value) {
+            os << value;
+            return *this;
+        }
+
+        Line &operator<<(std::ostream &(*manipulator)(std::ostream &)) {
+            os << manipulator;
+            return *this;
+        }
+    };
+}
+
+#define LOG_AT(level) \
+    if (!Log::enabled(level)) {} else Log::Line(level, __FUNCTION__)
+
+#define LOG_TRACE LOG_AT(LogLevel::TRACE)
+#define LOG_DEBUG LOG_AT(LogLevel::DEBUG)
+#define LOG_INFO  LOG_AT(LogLevel::INFO)
+#define LOG_WARN  LOG_AT(LogLevel::WARN)
+#define LOG_ERROR LOG_AT(LogLevel::ERR)
 
 #endif //RELIABLE_OVER_UDP_LOG_H
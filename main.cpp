@@ -1,91 +1,213 @@
 #include <iostream>
 #include <fstream>
 #include <thread>
-#include <winsock2.h>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include "platform.h"
 #include "log.h"
 #include "reliable_GBN.h"
 #include "reliable_SR.h"
 #include "reliable_RENO.h"
 #include "reliable_helper.h"
+#include "congestion.h"
+
+static void logStats(const IReliable &reliable) {
+    auto stats = reliable.stats();
+    LOG_INFO << "srtt: " << stats.srtt.count() << " ns"
+             << " rttvar: " << stats.rttvar.count() << " ns"
+             << " rto: " << stats.rto.count() << " ns" << std::endl;
+    LOG_INFO << "packets sent: " << stats.packetsSent << " received: " << stats.packetsReceived
+             << " retransmits: " << stats.timeoutRetransmits << " timeout, " << stats.fastRetransmits << " fast"
+             << " duplicate acks: " << stats.duplicateAcks
+             << " dropped: " << stats.checksumFailures << " checksum, " << stats.addressMismatches << " address"
+             << std::endl;
+}
 
 int main(int argc, char *argv[]) {
+#ifdef _WIN32
     WSADATA wsaData;
     int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
     if (result != 0) {
         std::cout << "WSAStartup failed: " << result << std::endl;
         return 1;
     }
+#endif
 
     // sender
-    // program.exe server <method> <port> <filename>
-    if (argc == 5 && std::string_view(argv[1]) == "server") {
+    // program.exe server <method> <port> <filename> [none | reno | cubic | bbr]
+    if ((argc == 5 || argc == 6) && std::string_view(argv[1]) == "server") {
         // arg parse
         std::string method = argv[2];
         uint16_t port = std::stoi(argv[3]);
         std::string filename = argv[4];
-
-        // open file
-        std::ifstream f(filename, std::ios::binary);
-        if (!f.is_open()) {
-            std::cout << "file not found: " << filename << std::endl;
+        auto congestion = argc == 6 ? CongestionHelper::parse(argv[5]) : std::nullopt;
+        if (argc == 6 && !congestion) {
+            std::cout << "unknown congestion control: " << argv[5] << std::endl;
             return 1;
         }
 
-        // get file size
-        f.seekg(0, std::ios::end);
-        int fileSize = f.tellg();
-
-        // read file
-        auto mem = std::make_unique<uint8_t[]>(fileSize);
-        f.seekg(0, std::ios::beg);
-        f.read((char *) mem.get(), fileSize);
+        // open file, mapped, or read in chunks while sending
+        const uint64_t streamBufferSize = 16 * 1024 * 1024; // 16M
+        auto source = StreamHelper::openSource(filename, streamBufferSize);
+        if (source == nullptr) {
+            std::cout << "failed to open file: " << filename << std::endl;
+            return 1;
+        }
 
         // send file
         std::unique_ptr<IReliable> reliable;
+        try {
+            if (method == "GBN") {
+                reliable = ReliableHelper::listen<ReliableGBN>(port, MAX_PACKET_SIZE,
+                                                               congestion.value_or(ReliableGBN::defaultCongestion));
+            } else if (method == "SR") {
+                reliable = ReliableHelper::listen<ReliableSR>(port, MAX_PACKET_SIZE,
+                                                              congestion.value_or(ReliableSR::defaultCongestion));
+            } else if (method == "RENO") {
+                reliable = ReliableHelper::listen<ReliableRENO>(port, MAX_PACKET_SIZE,
+                                                                congestion.value_or(ReliableRENO::defaultCongestion));
+            } else {
+                std::cout << "unknown method: " << method << std::endl;
+                return 1;
+            }
+        } catch (const std::exception &e) {
+            LOG_ERROR << "no client connected: " << e.what() << std::endl;
+            return 1;
+        }
+        bool sent;
+        {
+            StatsDumper dumper([&reliable] { return reliable->stats(); },
+                               "role=\"server\",method=\"" + method + "\"");
+            sent = reliable->send(*source);
+        }
+        logStats(*reliable);
+        LOG_INFO << "packet pool allocations: " << PacketPool::allocationCount() << std::endl;
+        if (!sent) {
+            LOG_ERROR << "transfer failed, the client stopped answering" << std::endl;
+            return 1;
+        }
+    }
+
+    // sender, serving the same file to every client which connects
+    // program.exe serve <method> <port> <filename> [workers] [none | reno | cubic | bbr]
+    if (argc >= 5 && argc <= 7 && std::string_view(argv[1]) == "serve") {
+        // arg parse
+        std::string method = argv[2];
+        uint16_t port = std::stoi(argv[3]);
+        std::string filename = argv[4];
+
+        // workers may be left out before the congestion control
+        int workers = 1;
+        const char *congestionName = argc == 7 ? argv[6] : nullptr;
+        if (argc >= 6) {
+            std::string_view arg = argv[5];
+            auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), workers);
+            bool numeric = error == std::errc() && end == arg.data() + arg.size();
+            if (!numeric && argc == 6) {
+                workers = 1;
+                congestionName = argv[5];
+            } else if (!numeric || workers < 1) {
+                std::cout << "invalid number of workers: " << arg << std::endl;
+                std::cout << "usage: serve <method> <port> <filename> [workers] [none | reno | cubic | bbr]"
+                          << std::endl;
+                return 1;
+            }
+        }
+        auto congestion = congestionName ? CongestionHelper::parse(congestionName) : std::nullopt;
+        if (congestionName && !congestion) {
+            std::cout << "unknown congestion control: " << congestionName << std::endl;
+            return 1;
+        }
+
+        // every session opens the file itself, a mapped file shares the page cache
+        const uint64_t sessionBufferSize = 4 * 1024 * 1024; // 4M
+        if (StreamHelper::openSource(filename, sessionBufferSize) == nullptr) {
+            std::cout << "failed to open file: " << filename << std::endl;
+            return 1;
+        }
+
+        auto opener = [&filename, sessionBufferSize] {
+            return StreamHelper::openSource(filename, sessionBufferSize);
+        };
+
+        std::unique_ptr<ShardedServer> server;
         if (method == "GBN") {
-            reliable = ReliableHelper::listen<ReliableGBN>(port);
+            server = ReliableHelper::serve<ReliableGBN>(port, opener, workers,
+                                                        congestion.value_or(ReliableGBN::defaultCongestion));
         } else if (method == "SR") {
-            reliable = ReliableHelper::listen<ReliableSR>(port);
+            server = ReliableHelper::serve<ReliableSR>(port, opener, workers,
+                                                       congestion.value_or(ReliableSR::defaultCongestion));
         } else if (method == "RENO") {
-            reliable = ReliableHelper::listen<ReliableRENO>(port);
+            server = ReliableHelper::serve<ReliableRENO>(port, opener, workers,
+                                                         congestion.value_or(ReliableRENO::defaultCongestion));
         } else {
             std::cout << "unknown method: " << method << std::endl;
             return 1;
         }
-        reliable->send(mem.get(), fileSize);
+        StatsDumper dumper([&server] { return server->stats(); },
+                           "role=\"serve\",method=\"" + method + "\"");
+        server->run();
     }
 
     // receiver
-    // program.exe client <method> <server ip> <server port> <filename>
-    if (argc == 6 && std::string_view(argv[1]) == "client") {
+    // program.exe client <method> <server ip> <server port> <filename> [packet size | probe]
+    if ((argc == 6 || argc == 7) && std::string_view(argv[1]) == "client") {
         // arg parse
         std::string method = argv[2];
         std::string ip = argv[3];
         uint16_t port = std::stoi(argv[4]);
         std::string filename = argv[5];
+        // probe finds the largest packet size the path carries unfragmented
+        bool probe = argc == 7 && std::string_view(argv[6]) == "probe";
+        uint32_t packetSize = argc == 7 && !probe ? std::stoi(argv[6]) : MAX_PACKET_SIZE;
+
+        // slices are written to the file as they arrive
+        auto sink = StreamHelper::openSink(filename);
+        if (sink == nullptr) {
+            std::cout << "failed to open file: " << filename << std::endl;
+            return 1;
+        }
 
-        const auto recvBufferSize = 20 * 1024 * 1024; // 20M
-        auto mem = std::make_unique<uint8_t[]>(recvBufferSize);
-        memset(mem.get(), 0xff, recvBufferSize);
         std::unique_ptr<IReliable> reliable;
-        if (method == "GBN") {
-            reliable = ReliableHelper::connect<ReliableGBN>(ip, port);
-        } else if (method == "SR") {
-            reliable = ReliableHelper::connect<ReliableSR>(ip, port);
-        } else if (method == "RENO") {
-            reliable = ReliableHelper::connect<ReliableRENO>(ip, port);
-        } else {
-            std::cout << "unknown method: " << method << std::endl;
+        try {
+            if (method == "GBN") {
+                reliable = ReliableHelper::connect<ReliableGBN>(ip, port, packetSize, probe);
+            } else if (method == "SR") {
+                reliable = ReliableHelper::connect<ReliableSR>(ip, port, packetSize, probe);
+            } else if (method == "RENO") {
+                reliable = ReliableHelper::connect<ReliableRENO>(ip, port, packetSize, probe);
+            } else {
+                std::cout << "unknown method: " << method << std::endl;
+                return 1;
+            }
+        } catch (const std::exception &e) {
+            LOG_ERROR << "failed to connect to " << ip << ":" << port << ": " << e.what() << std::endl;
             return 1;
         }
-        int received = reliable->recv(mem.get(), recvBufferSize);
-        LOG << "received " << received << " bytes" << std::endl;
 
-        // write to file
-        std::ofstream f(filename, std::ios::binary);
-        f.write((char *) mem.get(), received);
+        // connected, but the server may still give up halfway (or the sink fail)
+        uint64_t received;
+        try {
+            StatsDumper dumper([&reliable] { return reliable->stats(); },
+                               "role=\"client\",method=\"" + method + "\"");
+            received = reliable->recv(*sink);
+        } catch (const std::exception &e) {
+            LOG_ERROR << "transfer failed: " << e.what() << std::endl;
+            logStats(*reliable);
+            return 1;
+        }
+        if (!sink->finish()) {
+            LOG_ERROR << "failed to write file: " << filename << std::endl;
+            return 1;
+        }
+        LOG_INFO << "received " << received << " bytes" << std::endl;
+        logStats(*reliable);
+        LOG_INFO << "packet pool allocations: " << PacketPool::allocationCount() << std::endl;
     }
 
+#ifdef _WIN32
     WSACleanup();
+#endif
     return 0;
 }
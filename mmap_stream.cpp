@@ -0,0 +1,176 @@
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "log.h"
+#include "mmap_stream.h"
+
+// the output file grows by doubling, starting here, up to growthLimit a step
+const static uint64_t initialCapacity = 64ull * 1024 * 1024;
+const static uint64_t growthLimit = 1024ull * 1024 * 1024;
+
+MmapSource::MmapSource(const std::string &filename) {
+    int f = open(filename.c_str(), O_RDONLY);
+    if (f == -1) {
+        return;
+    }
+
+    struct stat st{};
+    if (fstat(f, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(f);
+        return;
+    }
+
+    // an empty file has nothing to map, but is still a valid source
+    if (st.st_size > 0) {
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+        if (p == MAP_FAILED) {
+            LOG_WARN << "mmap() failed: " << errno << std::endl;
+            close(f);
+            return;
+        }
+        // slices are read front to back, let the kernel read ahead
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        map = static_cast<uint8_t *>(p);
+    }
+
+    fd = f;
+    len = st.st_size;
+}
+
+MmapSource::~MmapSource() {
+    if (map != nullptr) {
+        munmap(map, len);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+MmapSink::MmapSink(const std::string &filename)
+        : path(filename), temporary(filename + ".part") {
+    // only a regular file can be preallocated and mapped, not /dev/null or a pipe
+    struct stat st{};
+    if (stat(filename.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) {
+        return;
+    }
+
+    int f = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (f == -1) {
+        return;
+    }
+
+    // the first step up front, where it fails (e.g. a file system without
+    // room or mmap) the sink is not open and a plain FileSink takes over
+    fd = f;
+    if (!grow(initialCapacity)) {
+        unmap();
+        close(fd);
+        fd = -1;
+        unlink(temporary.c_str());
+    }
+}
+
+MmapSink::~MmapSink() {
+    unmap();
+    if (fd != -1) {
+        // never finished, what was written is not the whole file
+        LOG_WARN << "transfer incomplete, removing " << temporary << std::endl;
+        close(fd);
+        unlink(temporary.c_str());
+    }
+}
+
+void MmapSink::unmap() {
+    if (map != nullptr) {
+        munmap(map, capacity);
+        map = nullptr;
+    }
+    capacity = 0;
+}
+
+bool MmapSink::finish() {
+    if (fd == -1) {
+        return false;
+    }
+
+    // drop the preallocated tail nobody wrote to, then show the file
+    unmap();
+    bool cut = ftruncate(fd, static_cast<off_t>(len)) == 0;
+    if (!cut) {
+        LOG_ERROR << "ftruncate() failed: " << errno << std::endl;
+    }
+    close(fd);
+    fd = -1;
+    if (!cut) {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) == -1) {
+        LOG_ERROR << "failed to move " << temporary << " to " << path << ": " << errno << std::endl;
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MmapSink::grow(uint64_t needed) {
+    uint64_t newCapacity = (std::max)(capacity, initialCapacity);
+    while (newCapacity < needed) {
+        newCapacity += (std::min)(newCapacity, growthLimit);
+    }
+
+    // reserve the blocks first, so a full disk fails here and not as a
+    // SIGBUS on some later store into the mapping
+#ifdef __linux__
+    if (fallocate(fd, 0, 0, static_cast<off_t>(newCapacity)) == -1 &&
+        (errno != EOPNOTSUPP || ftruncate(fd, static_cast<off_t>(newCapacity)) == -1)) {
+#else
+    if (ftruncate(fd, static_cast<off_t>(newCapacity)) == -1) {
+#endif
+        LOG_ERROR << "failed to preallocate " << newCapacity << " bytes: " << errno << std::endl;
+        return false;
+    }
+
+    void *p;
+#ifdef __linux__
+    if (map != nullptr) {
+        p = mremap(map, capacity, newCapacity, MREMAP_MAYMOVE);
+    } else {
+        p = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+#else
+    if (map != nullptr) {
+        munmap(map, capacity);
+        map = nullptr;
+    }
+    p = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+    if (p == MAP_FAILED) {
+        LOG_ERROR << "failed to map " << newCapacity << " bytes: " << errno << std::endl;
+        return false;
+    }
+
+    map = static_cast<uint8_t *>(p);
+    capacity = newCapacity;
+    return true;
+}
+
+bool MmapSink::write(uint64_t offset, const uint8_t *data, uint32_t sliceLen) {
+    if (offset + sliceLen > capacity && !grow(offset + sliceLen)) {
+        return false;
+    }
+
+    memcpy(map + offset, data, sliceLen);
+    len = (std::max)(len, offset + sliceLen);
+    return true;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef RELIABLE_OVER_UDP_MMAP_STREAM_H
+#define RELIABLE_OVER_UDP_MMAP_STREAM_H
+
+// sources and sinks backed by a memory mapped file, posix only,
+// windows keeps using FileSource and FileSink
+
+#ifndef _WIN32
+
+#include <cstdint>
+#include <string>
+#include "stream.h"
+
+// maps the whole file, slices are sent straight from the page cache
+class MmapSource : public ISource {
+    int fd = -1;
+    uint8_t *map = nullptr;
+    uint64_t len = 0;
+public:
+    explicit MmapSource(const std::string &filename);
+
+    MmapSource(const MmapSource &) = delete;
+
+    MmapSource &operator=(const MmapSource &) = delete;
+
+    ~MmapSource() override;
+
+    bool isOpen() const {
+        return fd != -1;
+    }
+
+    uint64_t size() const override {
+        return len;
+    }
+
+    const uint8_t *acquire(uint64_t offset, uint32_t) override {
+        return map + offset;
+    }
+
+    void release(uint64_t) override {}
+};
+
+// the receiver does not know the file size up front, so the file is
+// preallocated and mapped in growing steps, then cut to the bytes written
+//
+// it is written as filename.part and renamed to filename by finish(), an
+// aborted transfer removes it, so a zero padded file never passes for a
+// complete one (a killed process leaves the .part behind)
+//
+// only for a regular file, or none yet, whose first step can be
+// preallocated and mapped, else it is not open
+class MmapSink : public ISink {
+    std::string path;
+    std::string temporary;
+    int fd = -1;
+    uint8_t *map = nullptr;
+    uint64_t capacity = 0;
+    uint64_t len = 0;   // highest byte written so far
+
+    bool grow(uint64_t needed);
+
+    void unmap();
+public:
+    explicit MmapSink(const std::string &filename);
+
+    MmapSink(const MmapSink &) = delete;
+
+    MmapSink &operator=(const MmapSink &) = delete;
+
+    ~MmapSink() override;
+
+    bool isOpen() const {
+        return fd != -1;
+    }
+
+    bool write(uint64_t offset, const uint8_t *data, uint32_t sliceLen) override;
+
+    bool finish() override;
+};
+
+#endif
+
+#endif //RELIABLE_OVER_UDP_MMAP_STREAM_H
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "pacer.h"
+
+using Seconds = std::chrono::duration<double>;
+
+// the bucket holds this long a stretch of slices
+const static Seconds burstTime = std::chrono::milliseconds(1);
+const static double minBurst = 2;
+
+static uint64_t maxRateFromEnv() {
+    const char *env = std::getenv("RELIABLE_MAX_RATE");
+    if (env == nullptr) {
+        return 0;
+    }
+    return std::strtoull(env, nullptr, 10);
+}
+
+std::atomic<uint64_t> Pacer::maxBytesPerSecond = maxRateFromEnv();
+
+void Pacer::setMaxRate(uint64_t bytesPerSecond) {
+    maxBytesPerSecond.store(bytesPerSecond, std::memory_order_relaxed);
+}
+
+uint64_t Pacer::maxRate() {
+    return maxBytesPerSecond.load(std::memory_order_relaxed);
+}
+
+void Pacer::setRate(double rate) {
+    slicesPerSecond = (std::max)(rate, 0.0);
+}
+
+double Pacer::burst() const {
+    return (std::max)(minBurst, slicesPerSecond * burstTime.count());
+}
+
+void Pacer::refill(Clock::time_point now) {
+    if (!started) {
+        // a fresh sender may send one burst at once
+        started = true;
+        tokens = burst();
+    } else if (now > refilled) {
+        tokens = (std::min)(burst(), tokens + slicesPerSecond * Seconds(now - refilled).count());
+    }
+    refilled = now;
+}
+
+uint32_t Pacer::take(Clock::time_point now, uint32_t wanted) {
+    if (slicesPerSecond == 0) {
+        return wanted;
+    }
+
+    refill(now);
+    auto granted = static_cast<uint32_t>((std::min)(std::floor(tokens), static_cast<double>(wanted)));
+    tokens -= granted;
+    return granted;
+}
+
+Pacer::Clock::time_point Pacer::nextAt(Clock::time_point now) const {
+    if (slicesPerSecond == 0 || tokens >= 1) {
+        return now;
+    }
+    // rounded up, a wait truncated to zero would find the bucket still short
+    auto wait = Seconds((1 - tokens) / slicesPerSecond);
+    return now + std::chrono::ceil<Clock::duration>(wait);
+}
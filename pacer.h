@@ -0,0 +1,49 @@
+#ifndef RELIABLE_OVER_UDP_PACER_H
+#define RELIABLE_OVER_UDP_PACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// token bucket which spreads slices over time instead of sending a whole
+// window in one burst, refilled at rate slices per second and holding at
+// most a millisecond's worth (but at least 2), so a batch stays a batch
+//
+// every sender is held below a rate cap in bytes per second, which comes
+// from RELIABLE_MAX_RATE (e.g. 12500000 for 100 Mbit/s) or setMaxRate()
+class Pacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 for no cap
+    static void setMaxRate(uint64_t bytesPerSecond);
+
+    static uint64_t maxRate();
+
+    // slices per second, 0 for no pacing at all
+    void setRate(double slicesPerSecond);
+
+    double rate() const {
+        return slicesPerSecond;
+    }
+
+    // how many of wanted slices may go now, those are taken from the bucket
+    uint32_t take(Clock::time_point now, uint32_t wanted);
+
+    // when the next slice may go, meaningful once take() gave less than wanted
+    Clock::time_point nextAt(Clock::time_point now) const;
+
+private:
+    static std::atomic<uint64_t> maxBytesPerSecond;
+
+    double slicesPerSecond = 0;
+    double tokens = 0;
+    Clock::time_point refilled;
+    bool started = false;
+
+    double burst() const;
+
+    void refill(Clock::time_point now);
+};
+
+#endif //RELIABLE_OVER_UDP_PACER_H
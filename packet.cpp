@@ -1,39 +1,25 @@
+#include <cstring>
+#include "checksum.h"
 #include "packet.h"
 
-static uint16_t checksum(void *buf, int len) {
-    uint32_t sum = 0;
-    const uint16_t *p = reinterpret_cast<uint16_t *>(buf);
-    for (int i = 0; i < len / 2; i++) {
-        sum += p[i];
-        if (sum & 0xFFFF0000) {
-            sum &= 0xFFFF;
-            sum++;
-        }
-    }
-    return ~(sum & 0xFFFF);
-}
-
-bool PacketHelper::isValidPacket(const std::unique_ptr<Packet> &packet) {
-    return checksum(packet.get(), ROUND_UP(packet->len, sizeof(uint16_t))) == 0;
+bool PacketHelper::isValidPacket(const PacketPtr &packet) {
+    return ChecksumHelper::checksum(packet.get(), packet->len) == 0;
 }
 
-std::unique_ptr<Packet> PacketHelper::makePacket(
+PacketPtr PacketHelper::makePacket(
         PacketType type,
         uint32_t num,
         const void *data,
         uint32_t len
 ) {
-    // do round up, so we can calculate checksum
-    int alignedPacketSize = ROUND_UP(sizeof(Packet) + len, sizeof(uint16_t));
-
-    // allocate memory and clear it to all 0
-    auto packet = reinterpret_cast<Packet *>(new uint8_t[alignedPacketSize]{});
+    // pooled buffer, no need to clear it, the checksum pads odd lengths itself
+    auto packet = PacketPool::allocate();
 
     // fill packet
     packet->type = type;
     packet->num = num;
     packet->len = sizeof(Packet) + len;
-    if (type == PacketType::DATA) {
+    if (data != nullptr) {
         memcpy(packet->data, data, len);
     }
 
@@ -41,7 +27,47 @@ std::unique_ptr<Packet> PacketHelper::makePacket(
     // first set checksum to 0
     packet->checksum = 0;
     // calculate it now
-    packet->checksum = checksum(packet, alignedPacketSize);
+    packet->checksum = ChecksumHelper::checksum(packet.get(), packet->len);
+
+    return packet;
+}
+
+PacketSlice PacketHelper::makeSlice(uint32_t num, const void *data, uint32_t len) {
+    PacketSlice slice{};
+
+    slice.header.type = PacketType::DATA;
+    slice.header.num = num;
+    slice.header.len = sizeof(Packet) + len;
+    slice.header.checksum = 0;
+    slice.data = reinterpret_cast<const uint8_t *>(data);
+
+    InternetChecksum sum;
+    sum.update(&slice.header, sizeof(Packet));
+    sum.update(data, len);
+    slice.header.checksum = sum.finish();
 
-    return std::unique_ptr<Packet>(packet);
+    return slice;
+}
+
+bool PacketHelper::isSacked(const Packet &sack, uint32_t seq) {
+    if (seq < sack.num) {
+        return true;
+    }
+
+    uint32_t bit = seq - sack.num - 1;
+    if (seq == sack.num || sack.len < sizeof(Packet) + sizeof(uint32_t) ||
+        bit >= (sack.len - sizeof(Packet) - sizeof(uint32_t)) * 8) {
+        return false;
+    }
+
+    return (sack.data[sizeof(uint32_t) + bit / 8] >> (bit % 8)) & 1;
+}
+
+uint32_t PacketHelper::sackWindow(const Packet &sack) {
+    if (sack.len < sizeof(Packet) + sizeof(uint32_t)) {
+        return 0;
+    }
+    uint32_t window;
+    memcpy(&window, sack.data, sizeof(window));
+    return window;
 }
@@ -4,8 +4,17 @@
 #include <cstdint>
 #include <type_traits>
 #include <memory>
+#include "packet_pool.h"
 
+// largest datagram ever sent, packet buffers are this large, the size
+// used on a path is agreed in the handshake (see handshake.h)
 #define MAX_PACKET_SIZE (10240)
+// smallest, every path is assumed to carry it without fragmenting
+#define MIN_PACKET_SIZE (1200)
+// bitmap bytes a SACK carries at most, so it can describe this many
+// slices above the cumulative ack
+#define MAX_SACK_BYTES (1024)
+#define MAX_SACK_SLICES (MAX_SACK_BYTES * 8)
 #define ROUND_UP(a, b) (((uint32_t)(a) + ((uint32_t)(b) - 1)) / (uint32_t)(b) * (uint32_t)(b))
 
 #pragma pack(push, 1)
@@ -17,6 +26,7 @@ enum class PacketType : uint16_t {
     SYN_ACK,
     FIN,
     FIN_ACK,
+    SACK,
 };
 
 struct Packet {
@@ -27,22 +37,42 @@ struct Packet {
     uint32_t len;
 
     // data (if type is DATA)
+    // for SACK: num is the cumulative ack (next expected seq), data starts
+    // with the receive window (uint32_t, slices from num on the receiver
+    // takes), then bit i (LSB first) tells whether seq num + 1 + i has arrived
     uint8_t data[0];
 };
 
 static_assert(std::is_trivial_v<Packet>);
 
+#pragma pack(pop)
+
+// a DATA packet whose payload is not copied, the header lives here
+// and the payload is referenced from the caller's buffer,
+// it is put on the wire with scatter/gather io (header, then payload)
+struct PacketSlice {
+    Packet header;
+    const uint8_t *data;
+};
+
 namespace PacketHelper {
-    bool isValidPacket(const std::unique_ptr<Packet> &packet);
+    bool isValidPacket(const PacketPtr &packet);
 
-    std::unique_ptr<Packet> makePacket(
+    PacketPtr makePacket(
             PacketType type,
             uint32_t num = 0, /* seq or ack */
             const void *data = nullptr,
             uint32_t len = 0
     );
-}
 
-#pragma pack(pop)
+    // the checksum covers both the header and the referenced payload
+    PacketSlice makeSlice(uint32_t num, const void *data, uint32_t len);
+
+    // whether a SACK packet reports seq as received
+    bool isSacked(const Packet &sack, uint32_t seq);
+
+    // slices from the cumulative ack on the receiver of a SACK takes
+    uint32_t sackWindow(const Packet &sack);
+}
 
 #endif //RELIABLE_OVER_UDP_PACKET_H
@@ -0,0 +1,103 @@
+#include <mutex>
+#include <atomic>
+#include <new>
+#include "packet.h"
+#include "packet_pool.h"
+
+// buffers are carved from slabs and never returned to the heap,
+// each thread keeps a private free-list and trades batches of buffers
+// with a shared free-list, so a buffer allocated by the sender thread
+// and freed by the ACK thread still finds its way back
+
+const static uint32_t buffersPerSlab = 32;
+const static uint32_t localCacheLimit = 256;
+const static uint32_t transferBatch = 64;
+
+namespace {
+    struct FreeNode {
+        FreeNode *next;
+    };
+
+    struct FreeList {
+        FreeNode *head = nullptr;
+        uint32_t count = 0;
+
+        void push(FreeNode *node) {
+            node->next = head;
+            head = node;
+            count++;
+        }
+
+        FreeNode *pop() {
+            FreeNode *node = head;
+            head = node->next;
+            count--;
+            return node;
+        }
+
+        // move up to n nodes from this list to the other one
+        void moveTo(FreeList &other, uint32_t n) {
+            while (n-- > 0 && head != nullptr) {
+                other.push(pop());
+            }
+        }
+    };
+
+    std::mutex sharedMutex;
+    FreeList shared;
+    std::atomic<uint64_t> allocations = 0;
+
+    void allocateSlab(FreeList &list) {
+        auto slab = static_cast<uint8_t *>(::operator new(
+                static_cast<size_t>(buffersPerSlab) * MAX_PACKET_SIZE,
+                std::align_val_t(alignof(std::max_align_t))
+        ));
+        allocations.fetch_add(1, std::memory_order_relaxed);
+
+        for (uint32_t i = 0; i < buffersPerSlab; i++) {
+            list.push(reinterpret_cast<FreeNode *>(slab + i * MAX_PACKET_SIZE));
+        }
+    }
+
+    struct LocalCache {
+        FreeList list;
+
+        ~LocalCache() {
+            // thread exit, hand everything to the other threads
+            std::lock_guard lock(sharedMutex);
+            list.moveTo(shared, list.count);
+        }
+    };
+
+    thread_local LocalCache local;
+}
+
+PacketPtr PacketPool::allocate() {
+    if (local.list.head == nullptr) {
+        std::lock_guard lock(sharedMutex);
+        shared.moveTo(local.list, transferBatch);
+        if (local.list.head == nullptr) {
+            allocateSlab(local.list);
+        }
+    }
+
+    return PacketPtr(reinterpret_cast<Packet *>(local.list.pop()));
+}
+
+uint64_t PacketPool::allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void PacketPtr::reset() {
+    if (packet == nullptr) {
+        return;
+    }
+
+    local.list.push(reinterpret_cast<FreeNode *>(packet));
+    packet = nullptr;
+
+    if (local.list.count > localCacheLimit) {
+        std::lock_guard lock(sharedMutex);
+        local.list.moveTo(shared, transferBatch);
+    }
+}
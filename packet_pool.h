@@ -0,0 +1,73 @@
+#ifndef RELIABLE_OVER_UDP_PACKET_POOL_H
+#define RELIABLE_OVER_UDP_PACKET_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct Packet;
+
+// owning handle of a pooled packet buffer (MAX_PACKET_SIZE bytes),
+// gives the buffer back to the pool instead of deleting it
+class PacketPtr {
+    Packet *packet = nullptr;
+public:
+    PacketPtr() = default;
+
+    PacketPtr(std::nullptr_t) {}
+
+    explicit PacketPtr(Packet *packet) : packet(packet) {}
+
+    ~PacketPtr() {
+        reset();
+    }
+
+    PacketPtr(const PacketPtr &) = delete;
+
+    PacketPtr &operator=(const PacketPtr &) = delete;
+
+    PacketPtr(PacketPtr &&obj) noexcept : packet(obj.packet) {
+        obj.packet = nullptr;
+    }
+
+    PacketPtr &operator=(PacketPtr &&obj) noexcept {
+        if (this != &obj) {
+            reset();
+            packet = obj.packet;
+            obj.packet = nullptr;
+        }
+        return *this;
+    }
+
+    Packet *get() const {
+        return packet;
+    }
+
+    Packet *operator->() const {
+        return packet;
+    }
+
+    Packet &operator*() const {
+        return *packet;
+    }
+
+    explicit operator bool() const {
+        return packet != nullptr;
+    }
+
+    bool operator==(std::nullptr_t) const {
+        return packet == nullptr;
+    }
+
+    void reset();
+};
+
+namespace PacketPool {
+    // take a buffer of MAX_PACKET_SIZE bytes, the content is NOT cleared
+    PacketPtr allocate();
+
+    // number of heap allocations the pool has made so far,
+    // it stops growing once the pool is warm
+    uint64_t allocationCount();
+}
+
+#endif //RELIABLE_OVER_UDP_PACKET_POOL_H
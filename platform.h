@@ -0,0 +1,40 @@
+#ifndef RELIABLE_OVER_UDP_PLATFORM_H
+#define RELIABLE_OVER_UDP_PLATFORM_H
+
+// thin portability layer over the socket API,
+// winsock on windows, BSD sockets everywhere else
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+inline int lastSocketError() {
+    return WSAGetLastError();
+}
+
+#else
+
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using SOCKET = int;
+
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+
+inline int closesocket(SOCKET s) {
+    return close(s);
+}
+
+inline int lastSocketError() {
+    return errno;
+}
+
+#endif
+
+#endif //RELIABLE_OVER_UDP_PLATFORM_H
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <csignal>
+#include <string>
+#include <string_view>
+#include "platform.h"
+#include "log.h"
+#include "impair_proxy.h"
+
+// network impairment proxy, a bad link between a client and a server on loopback
+// program.exe <listen port> <server ip> <server port> [options]
+//   --loss P                random loss
+//   --burst ENTER EXIT      Gilbert-Elliott bursts, per datagram chances to turn bad and good again
+//   --burst-loss P          loss while bad, 1 by default
+//   --delay MS              one way delay
+//   --jitter MS             delay varies by up to this much either way
+//   --reorder P             share of datagrams held back
+//   --reorder-delay MS      by this much, 1 ms by default
+//   --duplicate P           share of datagrams sent twice
+//   --rate MBIT             bandwidth cap
+//   --queue KB              bytes queued in front of the cap, 256 KB by default
+//   --seed N                the same seed and traffic give the same decisions
+//   --direction D           both (default), forward (client to server) or backward
+// clients connect to the listen port instead of the server, ctrl-c prints
+// what the link did, RELIABLE_LOG_LEVEL=debug logs every decision
+
+static ImpairProxy *running = nullptr;
+
+static void onSignal(int) {
+    if (running != nullptr) {
+        running->stop();
+    }
+}
+
+static ImpairmentConfig::Duration millis(const char *arg) {
+    return std::chrono::duration_cast<ImpairmentConfig::Duration>(
+            std::chrono::duration<double, std::milli>(std::stod(arg)));
+}
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (result != 0) {
+        std::cout << "WSAStartup failed: " << result << std::endl;
+        return 1;
+    }
+#endif
+
+    if (argc < 4) {
+        std::cout << "usage: " << argv[0] << " <listen port> <server ip> <server port> [options]" << std::endl;
+        return 1;
+    }
+    uint16_t listenPort = std::stoi(argv[1]);
+    std::string serverIp = argv[2];
+    uint16_t serverPort = std::stoi(argv[3]);
+
+    ImpairmentConfig config;
+    std::string direction = "both";
+    for (int i = 4; i < argc; i++) {
+        std::string_view option = argv[i];
+        // every option takes one value, but --burst takes two
+        int values = option == "--burst" ? 2 : 1;
+        if (i + values >= argc) {
+            std::cout << "missing value for " << option << std::endl;
+            return 1;
+        }
+        const char *value = argv[i + 1];
+
+        if (option == "--loss") {
+            config.loss = std::stod(value);
+        } else if (option == "--burst") {
+            config.burstEnter = std::stod(value);
+            config.burstExit = std::stod(argv[i + 2]);
+        } else if (option == "--burst-loss") {
+            config.burstLoss = std::stod(value);
+        } else if (option == "--delay") {
+            config.delay = millis(value);
+        } else if (option == "--jitter") {
+            config.jitter = millis(value);
+        } else if (option == "--reorder") {
+            config.reorder = std::stod(value);
+        } else if (option == "--reorder-delay") {
+            config.reorderDelay = millis(value);
+        } else if (option == "--duplicate") {
+            config.duplicate = std::stod(value);
+        } else if (option == "--rate") {
+            config.rate = static_cast<uint64_t>(std::stod(value) * 1000 * 1000 / 8);
+        } else if (option == "--queue") {
+            config.queueLimit = std::stoull(value) * 1024;
+        } else if (option == "--seed") {
+            config.seed = std::stoull(value);
+        } else if (option == "--direction") {
+            direction = value;
+        } else {
+            std::cout << "unknown option: " << option << std::endl;
+            return 1;
+        }
+        i += values;
+    }
+
+    if (direction != "both" && direction != "forward" && direction != "backward") {
+        std::cout << "unknown direction: " << direction << std::endl;
+        return 1;
+    }
+    // the other direction stays a clean link, on its own seeds all the same
+    ImpairmentConfig clean;
+    clean.seed = config.seed;
+    ImpairmentConfig forward = direction == "backward" ? clean : config;
+    ImpairmentConfig backward = direction == "forward" ? clean : config;
+
+    ImpairProxy proxy(listenPort, serverIp, serverPort, forward, backward);
+    std::cout << "forward link: " << forward.describe() << std::endl;
+    std::cout << "backward link: " << backward.describe() << std::endl;
+
+    running = &proxy;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    proxy.run();
+    running = nullptr;
+
+    proxy.report(std::cout);
+    return 0;
+}
@@ -1,218 +1,46 @@
-#include <thread>
-#include <condition_variable>
+#include <stdexcept>
 #include <utility>
-#include <deque>
-#include "log.h"
-#include "packet.h"
+#include "event_loop.h"
+#include "session_GBN.h"
 #include "reliable_GBN.h"
 
-const static auto waitTime = std::chrono::milliseconds(50);
-const static auto sendAckDelay = std::chrono::milliseconds(10);
-const static uint32_t N = 3;
-
-class WindowGBN {
-    // window size
-    const uint32_t N;
-
-    // send & recv utility
-    Unreliable &unreliable;
-
-    // window queue
-    uint32_t base;
-    uint32_t end;
-    std::deque<std::unique_ptr<Packet>> queue;
-    std::mutex m;
-    std::condition_variable cvQueue;
-
-    // timeout
-    std::thread timeoutThread;
-    std::condition_variable cvTimeout;
-
-public:
-    WindowGBN(uint32_t base, uint32_t end, uint32_t N, Unreliable &unreliable)
-            : base(base), end(end), N(N), unreliable(unreliable) {
-
-        // create timeout thread, for resending packets
-        timeoutThread = std::thread([this] {
-            std::unique_lock lock(m);
-            while (true) {
-                // set timer
-                if (cvTimeout.wait_for(lock, waitTime) == std::cv_status::timeout) {
-
-                    if (this->base == this->end) {
-                        break;
-                    }
-
-                    LOG << "timeout" << std::endl;
-                    for (auto &packet: queue) {
-                        this->unreliable.send(packet);
-                    }
-                }
-            }
-        });
-    }
-
-    void waitTimerToExit() {
-        timeoutThread.join();
-    }
-
-    void push(std::unique_ptr<Packet> packet) {
-        std::unique_lock lock(m);
-
-        cvQueue.wait(lock, [this] { return queue.size() < N; });
-
-        LOG << "sent packet " << packet->num << std::endl;
-
-        unreliable.send(packet);
-        queue.push_back(std::move(packet));
-
-        LOG << "after push, queue size = " << queue.size() << std::endl;
-    }
-
-    void recvAck(uint32_t ack) {
-        std::lock_guard lock(m);
-
-        LOG << "received ack " << ack << std::endl;
-
-        if (base < ack) {
-            while (base < ack) {
-                LOG << "move window" << std::endl;
-
-                queue.pop_front();
-                base++;
-            }
-            LOG << "after move, queue size = " << queue.size() << std::endl;
-            cvTimeout.notify_all(); // reset timer
-            cvQueue.notify_all(); // send next packet / notify finished
-        }
-    }
-};
-
-ReliableGBN::ReliableGBN(Unreliable unreliable)
-        : unreliable(std::move(unreliable)) {}
-
-bool ReliableGBN::send(uint8_t *buf, int len) {
-    const int dataSize = MAX_PACKET_SIZE - sizeof(Packet);
-    uint32_t seq = 0;
-    uint32_t end = ROUND_UP(len, dataSize) / dataSize;
-
-    WindowGBN window(seq, end, N, unreliable);
-
-    std::thread ackReceiver([this, &window, &end] {
-        while (true) {
-            auto packet = unreliable.recv();
-            if (packet &&
-                PacketHelper::isValidPacket(packet) &&
-                packet->type == PacketType::ACK) {
-                window.recvAck(packet->num);
-
-                if (packet->num == end) {
-                    break;
-                }
-            }
-        }
-    });
-
-    for (uint8_t *sliceBuf = buf;
-         sliceBuf < buf + len;
-         sliceBuf += dataSize, seq++) {
-
-        int sliceLen = (std::min)(static_cast<int>(len - (sliceBuf - buf)), dataSize);
-
-        window.push(PacketHelper::makePacket(
-                PacketType::DATA,
-                seq,
-                sliceBuf,
-                sliceLen
-        ));
-    }
-
-    ackReceiver.join();
-    window.waitTimerToExit();
-
-    LOG << "sending FIN" << std::endl;
-    if (!unreliable.send(PacketHelper::makePacket(PacketType::FIN))) {
-        LOG << "failed to send FIN" << std::endl;
-        return false;
-    }
-
-    LOG << "receiving FIN_ACK" << std::endl;
-    std::unique_ptr<Packet> packet = unreliable.recv();
-
-    if (packet == nullptr ||
-        !PacketHelper::isValidPacket(packet) ||
-        packet->type != PacketType::FIN_ACK) {
-        return false;
-    }
-
-    return true;
+ReliableGBN::ReliableGBN(Unreliable unreliable, Congestion congestion, uint32_t window)
+        : unreliable(std::move(unreliable)), congestion(congestion), window(window) {
+    this->unreliable.setStats(&counters);
 }
 
-int ReliableGBN::recv(uint8_t *buf, int len) {
-    uint32_t seq = 0;
-    bool exit = false;
-    std::mutex m;
-
-    std::thread t([this, &m, &seq, &exit] {
-        while (true) {
-            std::this_thread::sleep_for(sendAckDelay);
-
-            std::lock_guard lock(m);
-            if (exit) {
-                break;
-            }
-
-            LOG << "sending ACK " << seq << std::endl;
-
-            unreliable.send(PacketHelper::makePacket(PacketType::ACK, seq));
-        }
-    });
-
-    uint8_t *curr = buf;
-    while (true) {
-        if (curr >= buf + len) {
-            LOG << "buffer overflow" << std::endl;
-            throw std::runtime_error("buffer overflow");
-        }
-
-        LOG << "waiting for slice " << seq << std::endl;
-
-        auto packet = unreliable.recv();
-
-        std::unique_lock lock(m);
-
-        if (packet &&
-            PacketHelper::isValidPacket(packet) &&
-            packet->type == PacketType::DATA &&
-            packet->num == seq) {
-
-            LOG << "received slice " << seq << std::endl;
-
-            int sliceLen = packet->len - sizeof(Packet);
-            memcpy(curr, packet->data, sliceLen);
-            curr += sliceLen;
+ReliableStats ReliableGBN::stats() const {
+    return counters.snapshot(rtt);
+}
 
-            seq++;
-        } else if (packet &&
-                   PacketHelper::isValidPacket(packet) &&
-                   packet->type == PacketType::FIN) {
+std::unique_ptr<ISession> ReliableGBN::makeSender(ITransport &transport, ITimerService &timers,
+                                                RttEstimator &rtt, ISource &source,
+                                                Congestion congestion) {
+    return std::make_unique<SenderGBN>(transport, timers, rtt, source, defaultWindow,
+                                       CongestionHelper::create(congestion));
+}
 
-            LOG << "received FIN" << std::endl;
+std::unique_ptr<ReceiverSession> ReliableGBN::makeReceiver(ITransport &transport, ITimerService &timers,
+                                                           ISink &sink) {
+    return std::make_unique<ReceiverGBN>(transport, timers, sink);
+}
 
-            LOG << "sending FIN_ACK" << std::endl;
+bool ReliableGBN::send(ISource &source) {
+    // one thread drives the whole transfer, SACKs and timers alike
+    EventLoop loop;
+    SenderGBN sender(unreliable, loop, rtt, source, window, CongestionHelper::create(congestion));
+    SessionHelper::run(loop, unreliable, sender);
 
-            unreliable.send(PacketHelper::makePacket(PacketType::FIN_ACK));
-            exit = true;
-            lock.unlock();
-            t.join();
-            break;
-        } else {
+    return sender.succeeded();
+}
 
-            LOG << "received invalid packet" << std::endl;
+uint64_t ReliableGBN::recv(ISink &sink) {
+    EventLoop loop;
+    ReceiverGBN receiver(unreliable, loop, sink);
+    SessionHelper::run(loop, unreliable, receiver);
 
-        }
+    if (!receiver.succeeded()) {
+        throw std::runtime_error("failed to receive");
     }
-
-    return curr - buf;
+    return receiver.received();
 }
-
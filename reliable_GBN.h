@@ -1,17 +1,46 @@
 #ifndef RELIABLE_OVER_UDP_RELIABLE_GBN_H
 #define RELIABLE_OVER_UDP_RELIABLE_GBN_H
 
+#include <memory>
 #include "unreliable.h"
 #include "reliable_interface.h"
+#include "rtt_estimator.h"
+#include "session.h"
+#include "congestion.h"
 
 class ReliableGBN : public IReliable {
     Unreliable unreliable;
+    RttEstimator rtt;
+    // bumped by the transport and the sessions, see stats()
+    ConnectionStats counters;
+    Congestion congestion;
+    uint32_t window;
 public:
-    ReliableGBN(Unreliable unreliable);
+    // what send() runs unless told otherwise
+    constexpr static Congestion defaultCongestion = Congestion::NONE;
+    // slices in flight without a controller
+    constexpr static uint32_t defaultWindow = 3;
 
-    bool send(uint8_t *buf, int len) override;
+    ReliableGBN(Unreliable unreliable, Congestion congestion = defaultCongestion,
+                uint32_t window = defaultWindow);
 
-    int recv(uint8_t *buf, int len) override;
+    using IReliable::send;
+    using IReliable::recv;
+
+    bool send(ISource &source) override;
+
+    uint64_t recv(ISink &sink) override;
+
+    ReliableStats stats() const override;
+
+    // the sending side as a state machine, for whoever drives many sessions
+    static std::unique_ptr<ISession> makeSender(ITransport &transport, ITimerService &timers,
+                                                RttEstimator &rtt, ISource &source,
+                                                Congestion congestion = defaultCongestion);
+
+    // the receiving side, likewise
+    static std::unique_ptr<ReceiverSession> makeReceiver(ITransport &transport, ITimerService &timers,
+                                                         ISink &sink);
 };
 
 #endif //RELIABLE_OVER_UDP_RELIABLE_GBN_H
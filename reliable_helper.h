@@ -3,22 +3,40 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <chrono>
 #include <cstdint>
 #include <stdexcept>
 #include <iostream>
 #include "log.h"
 #include "reliable_interface.h"
+#include "handshake.h"
+#include "congestion.h"
+#include "sharded_server.h"
 
 namespace ReliableHelper {
 
+    // socket buffers hold the largest window a congestion controller may open
+    const static int socketBufferSize = ICongestionControl::maxWindow * MAX_PACKET_SIZE;
+
+    inline void setBufferSize(SOCKET s) {
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char *) &socketBufferSize, sizeof(socketBufferSize));
+        setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char *) &socketBufferSize, sizeof(socketBufferSize));
+    }
+
+    // packets are at most packetSize bytes, or less if the client asks for less,
+    // what it sends runs under congestion, with window as Ty takes it,
+    // a later SYN of the client is answered by the sender (see SenderSession)
     template <typename Ty>
     typename std::enable_if_t<std::is_base_of_v<IReliable, Ty>, std::unique_ptr<IReliable>>
-    listen(uint16_t port) {
+    listen(uint16_t port, uint32_t packetSize = MAX_PACKET_SIZE, Congestion congestion = Ty::defaultCongestion,
+           uint32_t window = Ty::defaultWindow) {
         SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
         if (s == INVALID_SOCKET) {
-            LOG << "socket() failed: " << WSAGetLastError() << std::endl;
+            LOG_ERROR << "socket() failed: " << lastSocketError() << std::endl;
             throw std::runtime_error("socket() failed");
         }
+        setBufferSize(s);
 
         sockaddr_in listenAddr;
         listenAddr.sin_family = AF_INET;
@@ -26,76 +44,115 @@ namespace ReliableHelper {
         listenAddr.sin_addr.s_addr = INADDR_ANY;
 
         if (bind(s, (sockaddr *) &listenAddr, sizeof(listenAddr)) == SOCKET_ERROR) {
-            LOG << "bind() failed: " << WSAGetLastError() << std::endl;
+            LOG_ERROR << "bind() failed: " << lastSocketError() << std::endl;
             throw std::runtime_error("bind() failed");
         }
 
         Unreliable unreliable(s);
 
         // 1. recv SYN
-        std::unique_ptr<Packet> packet = unreliable.recv();
+        PacketPtr packet = unreliable.recv();
 
         if (packet == nullptr ||
             !PacketHelper::isValidPacket(packet) ||
             packet->type != PacketType::SYN) {
 
-            LOG << "failed to receive packet from client" << std::endl;
+            LOG_ERROR << "failed to receive packet from client" << std::endl;
             throw std::runtime_error("failed to receive packet from client");
         }
 
-        LOG << "received SYN from client" << std::endl;
+        LOG_INFO << "received SYN from client" << std::endl;
 
-        // 2. send SYN_ACK
+        // 2. send SYN_ACK, with the packet size agreed to
+        unreliable.setPacketSize(HandshakeHelper::agree(*packet, packetSize));
 
-        if (!unreliable.send(PacketHelper::makePacket(PacketType::SYN_ACK))) {
-            LOG << "failed to send SYN_ACK to client" << std::endl;
+        if (!unreliable.send(PacketHelper::makePacket(PacketType::SYN_ACK, unreliable.packetSize()))) {
+            LOG_ERROR << "failed to send SYN_ACK to client" << std::endl;
             throw std::runtime_error("failed to send SYN_ACK to client");
         }
 
-        LOG << "sent SYN_ACK to client" << std::endl;
+        LOG_INFO << "sent SYN_ACK to client" << std::endl;
 
-        LOG << "connect established" << std::endl;
-        return std::make_unique<Ty>(std::move(unreliable));
+        LOG_INFO << "connect established" << std::endl;
+        return std::make_unique<Ty>(std::move(unreliable), congestion, window);
     }
 
+    // propose packets of packetSize bytes, with probe the SYNs find the
+    // largest size up to packetSize which the path carries unfragmented
     template <typename Ty>
     typename std::enable_if_t<std::is_base_of_v<IReliable, Ty>, std::unique_ptr<IReliable>>
-    connect(const std::string &ip, uint16_t port) {
+    connect(const std::string &ip, uint16_t port, uint32_t packetSize = MAX_PACKET_SIZE, bool probe = false,
+            Congestion congestion = Ty::defaultCongestion) {
         SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
         if (s == INVALID_SOCKET) {
-            LOG << "socket() failed: " << WSAGetLastError() << std::endl;
+            LOG_ERROR << "socket() failed: " << lastSocketError() << std::endl;
             throw std::runtime_error("socket() failed");
         }
+        setBufferSize(s);
 
         // create UDP socket wrapper, given the remote addr (server addr)
         Unreliable unreliable(s, ip, port);
+        probe = probe && HandshakeHelper::setDontFragment(s, true);
 
-        // 1. send SYN
+        auto attempts = HandshakeHelper::schedule(packetSize, probe);
+        for (const auto &attempt: attempts) {
 
-        if (!unreliable.send(PacketHelper::makePacket(PacketType::SYN))) {
-            LOG << "failed to send SYN to server" << std::endl;
-            throw std::runtime_error("failed to send SYN to server");
-        }
+            // 1. send SYN, too large for the first hop it fails right here
 
-        LOG << "sent SYN to server" << std::endl;
+            if (!unreliable.send(HandshakeHelper::makeSyn(attempt.packetSize, probe))) {
+                if (probe) {
+                    continue;
+                }
+                LOG_ERROR << "failed to send SYN to server" << std::endl;
+                throw std::runtime_error("failed to send SYN to server");
+            }
 
-        // 2. recv SYN_ACK
+            LOG_INFO << "sent SYN to server, packet size " << attempt.packetSize << std::endl;
 
-        std::unique_ptr<Packet> packet = unreliable.recv();
+            // 2. recv SYN_ACK
 
-        if (packet == nullptr ||
-            !PacketHelper::isValidPacket(packet) ||
-            packet->type != PacketType::SYN_ACK) {
+            auto deadline = std::chrono::steady_clock::now() + attempt.timeout;
+            std::vector<PacketPtr> packets;
+            while (unreliable.recv(packets, deadline - std::chrono::steady_clock::now(), 1) > 0) {
+                PacketPtr packet = std::move(packets.back());
+                packets.clear();
+                if (!PacketHelper::isValidPacket(packet) || packet->type != PacketType::SYN_ACK) {
+                    continue;
+                }
 
-            LOG << "failed to receive packet from server" << std::endl;
-            throw std::runtime_error("failed to receive packet from server");
-        }
+                uint32_t agreed = HandshakeHelper::agreed(*packet, attempts.front().packetSize);
+                if (agreed == 0) {
+                    throw std::runtime_error("failed to agree on a packet size");
+                }
+                unreliable.setPacketSize(agreed);
+                if (probe) {
+                    HandshakeHelper::setDontFragment(s, false);
+                }
+
+                LOG_INFO << "received SYN_ACK from server, packet size " << agreed << std::endl;
+
+                LOG_INFO << "connect established" << std::endl;
 
-        LOG << "received SYN_ACK from server" << std::endl;
+                return std::make_unique<Ty>(std::move(unreliable), congestion);
+            }
+        }
 
-        LOG << "connect established" << std::endl;
+        LOG_ERROR << "failed to receive packet from server" << std::endl;
+        throw std::runtime_error("failed to receive packet from server");
+    }
 
-        return std::make_unique<Ty>(std::move(unreliable));
+    // accept any number of clients on port, every session sends what
+    // opener returns for it, the sessions run on the event loops of
+    // workers SO_REUSEPORT shards, call run() on the result to start serving
+    template <typename Ty>
+    typename std::enable_if_t<std::is_base_of_v<IReliable, Ty>, std::unique_ptr<ShardedServer>>
+    serve(uint16_t port, const Dispatcher::Opener &opener, int workers = 1,
+          Congestion congestion = Ty::defaultCongestion) {
+        auto factory = [congestion](ITransport &transport, ITimerService &timers, RttEstimator &rtt,
+                                    ISource &source) {
+            return Ty::makeSender(transport, timers, rtt, source, congestion);
+        };
+        return std::make_unique<ShardedServer>(port, workers, factory, opener);
     }
 }
 
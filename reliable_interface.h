@@ -4,12 +4,29 @@
 #include <string>
 #include <cstddef>
 #include "unreliable.h"
+#include "reliable_stats.h"
+#include "stream.h"
 
 class IReliable {
 public:
-    virtual bool send(uint8_t *buf, int len) = 0;
+    // stream every byte of source, memory use is bounded by the window
+    virtual bool send(ISource &source) = 0;
 
-    virtual int recv(uint8_t *buf, int len) = 0;
+    // returns the number of bytes written to sink
+    virtual uint64_t recv(ISink &sink) = 0;
+
+    bool send(const uint8_t *buf, uint64_t len) {
+        MemorySource source(buf, len);
+        return send(source);
+    }
+
+    uint64_t recv(uint8_t *buf, uint64_t len) {
+        MemorySink sink(buf, len);
+        return recv(sink);
+    }
+
+    // safe to call from any thread, also while a transfer is running
+    virtual ReliableStats stats() const = 0;
 
     virtual ~IReliable() = default;
 };
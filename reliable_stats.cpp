@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include "log.h"
+#include "reliable_stats.h"
+
+using Seconds = std::chrono::duration<double>;
+using Micros = std::chrono::duration<double, std::micro>;
+
+ReliableStats ConnectionStats::snapshot(const RttEstimator &rtt) const {
+    ReliableStats stats;
+    stats.srtt = rtt.srtt();
+    stats.rttvar = rtt.rttvar();
+    stats.rto = rtt.rto();
+    stats.packetsSent = packetsSent.load(std::memory_order_relaxed);
+    stats.bytesSent = bytesSent.load(std::memory_order_relaxed);
+    stats.packetsReceived = packetsReceived.load(std::memory_order_relaxed);
+    stats.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+    stats.timeoutRetransmits = timeoutRetransmits.load(std::memory_order_relaxed);
+    stats.fastRetransmits = fastRetransmits.load(std::memory_order_relaxed);
+    stats.duplicateAcks = duplicateAcks.load(std::memory_order_relaxed);
+    stats.checksumFailures = checksumFailures.load(std::memory_order_relaxed);
+    stats.addressMismatches = addressMismatches.load(std::memory_order_relaxed);
+    stats.cwnd = cwndSlices.load(std::memory_order_relaxed);
+    stats.ssthresh = ssthreshSlices.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < ReliableStats::rttBuckets; i++) {
+        stats.rttHistogram[i] = rttHistogram[i].load(std::memory_order_relaxed);
+    }
+    stats.rttSamples = rttSamples.load(std::memory_order_relaxed);
+    stats.rttSum = std::chrono::nanoseconds(rttSumNs.load(std::memory_order_relaxed));
+    return stats;
+}
+
+// upper bound of bucket i, but the last
+static std::chrono::nanoseconds bucketBound(size_t i) {
+    return ReliableStats::rttBucketWidth * (int64_t(1) << i);
+}
+
+std::string StatsHelper::toJson(const ReliableStats &stats) {
+    std::ostringstream out;
+    out << "{\"srtt_us\": " << Micros(stats.srtt).count()
+        << ", \"rttvar_us\": " << Micros(stats.rttvar).count()
+        << ", \"rto_us\": " << Micros(stats.rto).count()
+        << ", \"packets_sent\": " << stats.packetsSent
+        << ", \"bytes_sent\": " << stats.bytesSent
+        << ", \"packets_received\": " << stats.packetsReceived
+        << ", \"bytes_received\": " << stats.bytesReceived
+        << ", \"timeout_retransmits\": " << stats.timeoutRetransmits
+        << ", \"fast_retransmits\": " << stats.fastRetransmits
+        << ", \"duplicate_acks\": " << stats.duplicateAcks
+        << ", \"checksum_failures\": " << stats.checksumFailures
+        << ", \"address_mismatches\": " << stats.addressMismatches
+        << ", \"cwnd\": " << stats.cwnd
+        << ", \"ssthresh\": " << stats.ssthresh
+        << ", \"rtt_samples\": " << stats.rttSamples
+        << ", \"rtt_sum_us\": " << Micros(stats.rttSum).count()
+        << ", \"rtt_histogram\": [";
+    // not cumulative, the last bucket has no bound
+    for (size_t i = 0; i < ReliableStats::rttBuckets; i++) {
+        out << (i > 0 ? ", " : "") << "{\"le_us\": ";
+        if (i + 1 < ReliableStats::rttBuckets) {
+            out << Micros(bucketBound(i)).count();
+        } else {
+            out << "null";
+        }
+        out << ", \"count\": " << stats.rttHistogram[i] << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+// prometheus text format, one metric with its help and type and any number of samples
+class PrometheusWriter {
+    std::ostringstream out;
+    std::string_view labels;
+
+public:
+    explicit PrometheusWriter(std::string_view labels)
+            : labels(labels) {}
+
+    void metric(std::string_view name, std::string_view type, std::string_view help) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << type << "\n";
+    }
+
+    template <typename Ty>
+    void sample(std::string_view name, Ty value, std::string_view extra = {}) {
+        out << name;
+        if (!labels.empty() || !extra.empty()) {
+            out << "{" << labels << (!labels.empty() && !extra.empty() ? "," : "") << extra << "}";
+        }
+        out << " " << value << "\n";
+    }
+
+    std::string str() const {
+        return out.str();
+    }
+};
+
+std::string StatsHelper::toPrometheus(const ReliableStats &stats, std::string_view labels) {
+    PrometheusWriter writer(labels);
+
+    writer.metric("reliable_srtt_seconds", "gauge", "Smoothed round trip time.");
+    writer.sample("reliable_srtt_seconds", Seconds(stats.srtt).count());
+    writer.metric("reliable_rttvar_seconds", "gauge", "Round trip time variation.");
+    writer.sample("reliable_rttvar_seconds", Seconds(stats.rttvar).count());
+    writer.metric("reliable_rto_seconds", "gauge", "Retransmission timeout.");
+    writer.sample("reliable_rto_seconds", Seconds(stats.rto).count());
+
+    writer.metric("reliable_packets_sent_total", "counter", "Datagrams sent.");
+    writer.sample("reliable_packets_sent_total", stats.packetsSent);
+    writer.metric("reliable_bytes_sent_total", "counter", "Bytes sent, headers included.");
+    writer.sample("reliable_bytes_sent_total", stats.bytesSent);
+    writer.metric("reliable_packets_received_total", "counter", "Datagrams received.");
+    writer.sample("reliable_packets_received_total", stats.packetsReceived);
+    writer.metric("reliable_bytes_received_total", "counter", "Bytes received, headers included.");
+    writer.sample("reliable_bytes_received_total", stats.bytesReceived);
+
+    writer.metric("reliable_retransmits_total", "counter", "Slices sent again.");
+    writer.sample("reliable_retransmits_total", stats.timeoutRetransmits, "reason=\"timeout\"");
+    writer.sample("reliable_retransmits_total", stats.fastRetransmits, "reason=\"fast\"");
+    writer.metric("reliable_duplicate_acks_total", "counter", "SACKs which did not move the cumulative ack.");
+    writer.sample("reliable_duplicate_acks_total", stats.duplicateAcks);
+    writer.metric("reliable_dropped_total", "counter", "Datagrams dropped on receive.");
+    writer.sample("reliable_dropped_total", stats.checksumFailures, "reason=\"checksum\"");
+    writer.sample("reliable_dropped_total", stats.addressMismatches, "reason=\"address\"");
+
+    writer.metric("reliable_cwnd_slices", "gauge", "Congestion window of the sender.");
+    writer.sample("reliable_cwnd_slices", stats.cwnd);
+    writer.metric("reliable_ssthresh_slices", "gauge", "Slow start threshold of the sender, 0 for none.");
+    writer.sample("reliable_ssthresh_slices", stats.ssthresh);
+
+    writer.metric("reliable_rtt_seconds", "histogram", "Round trip time samples.");
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i + 1 < ReliableStats::rttBuckets; i++) {
+        cumulative += stats.rttHistogram[i];
+        std::ostringstream le;
+        le << "le=\"" << Seconds(bucketBound(i)).count() << "\"";
+        writer.sample("reliable_rtt_seconds_bucket", cumulative, le.str());
+    }
+    // from the buckets, not rttSamples, a snapshot taken mid update may be off by one
+    cumulative += stats.rttHistogram[ReliableStats::rttBuckets - 1];
+    writer.sample("reliable_rtt_seconds_bucket", cumulative, "le=\"+Inf\"");
+    writer.sample("reliable_rtt_seconds_sum", Seconds(stats.rttSum).count());
+    writer.sample("reliable_rtt_seconds_count", cumulative);
+
+    return writer.str();
+}
+
+void StatsHelper::accumulate(ReliableStats &total, const ReliableStats &stats) {
+    total.packetsSent += stats.packetsSent;
+    total.bytesSent += stats.bytesSent;
+    total.packetsReceived += stats.packetsReceived;
+    total.bytesReceived += stats.bytesReceived;
+    total.timeoutRetransmits += stats.timeoutRetransmits;
+    total.fastRetransmits += stats.fastRetransmits;
+    total.duplicateAcks += stats.duplicateAcks;
+    total.checksumFailures += stats.checksumFailures;
+    total.addressMismatches += stats.addressMismatches;
+    for (size_t i = 0; i < ReliableStats::rttBuckets; i++) {
+        total.rttHistogram[i] += stats.rttHistogram[i];
+    }
+    total.rttSamples += stats.rttSamples;
+    total.rttSum += stats.rttSum;
+}
+
+StatsDumper::StatsDumper(Snapshot snapshot, std::string labels)
+        : snapshot(std::move(snapshot)), labels(std::move(labels)) {
+    const char *env = std::getenv("RELIABLE_STATS");
+    if (env == nullptr) {
+        return;
+    }
+    format = env;
+    if (format != "json" && format != "prometheus") {
+        LOG_WARN << "unknown stats format: " << format << ", no stats" << std::endl;
+        format.clear();
+        return;
+    }
+    if (const char *file = std::getenv("RELIABLE_STATS_FILE")) {
+        path = file;
+    }
+    if (const char *ms = std::getenv("RELIABLE_STATS_INTERVAL")) {
+        interval = std::chrono::milliseconds((std::max)(std::atoll(ms), 1LL));
+    }
+
+    thread = std::thread([this] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+            dump();
+        }
+    });
+}
+
+StatsDumper::~StatsDumper() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    dump();
+}
+
+void StatsDumper::dump() {
+    auto stats = snapshot();
+    std::string text = format == "json" ? StatsHelper::toJson(stats) + "\n"
+                                        : StatsHelper::toPrometheus(stats, labels);
+    if (path.empty()) {
+        std::cerr << text << std::flush;
+        return;
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        out << text;
+        if (!out) {
+            LOG_WARN << "failed to write stats to " << temporary << std::endl;
+            return;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        // posix replaces the old file at once, windows moves onto no file only
+        std::remove(path.c_str());
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            LOG_WARN << "failed to move stats to " << path << std::endl;
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#ifndef RELIABLE_OVER_UDP_RELIABLE_STATS_H
+#define RELIABLE_OVER_UDP_RELIABLE_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "rtt_estimator.h"
+
+// snapshot of a connection's state, see IReliable::stats()
+struct ReliableStats {
+    // the rtt histogram: bucket i holds samples below rttBucketWidth << i,
+    // but the last one, which has no bound
+    constexpr static size_t rttBuckets = 16;
+    constexpr static std::chrono::nanoseconds rttBucketWidth = std::chrono::microseconds(100);
+
+    // round trip estimation (RFC 6298), srtt and rttvar are zero before the first sample
+    std::chrono::nanoseconds srtt{};
+    std::chrono::nanoseconds rttvar{};
+    std::chrono::nanoseconds rto{};
+
+    // datagrams through the connection's socket, headers included
+    uint64_t packetsSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t bytesReceived = 0;
+
+    // slices sent again, after their timer went off, or found lost by SACKs
+    uint64_t timeoutRetransmits = 0;
+    uint64_t fastRetransmits = 0;
+    // SACKs which did not move the cumulative ack
+    uint64_t duplicateAcks = 0;
+
+    // datagrams dropped, for a bad checksum, or from another address than the peer's
+    uint64_t checksumFailures = 0;
+    uint64_t addressMismatches = 0;
+
+    // the sender's window in slices, ssthresh is zero if its controller has none
+    uint32_t cwnd = 0;
+    uint32_t ssthresh = 0;
+
+    // round trip samples, as the sender took them
+    std::array<uint64_t, rttBuckets> rttHistogram{};
+    uint64_t rttSamples = 0;
+    std::chrono::nanoseconds rttSum{};
+};
+
+// the live counters of one connection, what ReliableStats is a snapshot of
+//
+// only the thread driving the connection updates them, so an update is a
+// plain load and store, no locked instruction on the hot path,
+// reads are allowed from any thread
+class ConnectionStats {
+public:
+    enum class Retransmit {
+        TIMEOUT,
+        FAST,
+    };
+
+    void sent(uint64_t packets, uint64_t bytes) {
+        add(packetsSent, packets);
+        add(bytesSent, bytes);
+    }
+
+    void received(uint64_t packets, uint64_t bytes) {
+        add(packetsReceived, packets);
+        add(bytesReceived, bytes);
+    }
+
+    void retransmitted(Retransmit reason, uint64_t slices) {
+        add(reason == Retransmit::FAST ? fastRetransmits : timeoutRetransmits, slices);
+    }
+
+    void duplicateAck() {
+        add(duplicateAcks, 1);
+    }
+
+    void checksumFailed() {
+        add(checksumFailures, 1);
+    }
+
+    void addressMismatched() {
+        add(addressMismatches, 1);
+    }
+
+    void window(uint32_t cwnd, uint32_t ssthresh) {
+        cwndSlices.store(cwnd, std::memory_order_relaxed);
+        ssthreshSlices.store(ssthresh, std::memory_order_relaxed);
+    }
+
+    void rttSample(std::chrono::nanoseconds rtt) {
+        auto width = static_cast<uint64_t>(rtt.count() / ReliableStats::rttBucketWidth.count());
+        size_t bucket = (std::min)(static_cast<size_t>(std::bit_width(width)), ReliableStats::rttBuckets - 1);
+        add(rttHistogram[bucket], 1);
+        add(rttSamples, 1);
+        add(rttSumNs, static_cast<uint64_t>(rtt.count()));
+    }
+
+    // the counters, with the rtt estimation of the same connection
+    ReliableStats snapshot(const RttEstimator &rtt) const;
+
+private:
+    std::atomic<uint64_t> packetsSent = 0;
+    std::atomic<uint64_t> bytesSent = 0;
+    std::atomic<uint64_t> packetsReceived = 0;
+    std::atomic<uint64_t> bytesReceived = 0;
+    std::atomic<uint64_t> timeoutRetransmits = 0;
+    std::atomic<uint64_t> fastRetransmits = 0;
+    std::atomic<uint64_t> duplicateAcks = 0;
+    std::atomic<uint64_t> checksumFailures = 0;
+    std::atomic<uint64_t> addressMismatches = 0;
+    std::atomic<uint32_t> cwndSlices = 0;
+    std::atomic<uint32_t> ssthreshSlices = 0;
+    std::array<std::atomic<uint64_t>, ReliableStats::rttBuckets> rttHistogram{};
+    std::atomic<uint64_t> rttSamples = 0;
+    std::atomic<uint64_t> rttSumNs = 0;
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+namespace StatsHelper {
+    // one JSON object, durations in microseconds
+    std::string toJson(const ReliableStats &stats);
+
+    // the prometheus text format, every metric named reliable_*, labels
+    // like role="client" go on every sample, durations in seconds
+    std::string toPrometheus(const ReliableStats &stats, std::string_view labels = {});
+
+    // add the counters and rtt samples of stats to total, for many
+    // connections, what only one connection has (srtt, rto, cwnd, ...) is left
+    void accumulate(ReliableStats &total, const ReliableStats &stats);
+}
+
+// dumps stats every interval from a thread of its own, and once more when
+// destroyed, as the environment says:
+//   RELIABLE_STATS           json (one object per line) or prometheus (text format), unset for none
+//   RELIABLE_STATS_INTERVAL  ms, 1000 by default
+//   RELIABLE_STATS_FILE      replaced on every dump, for a scraper (e.g. the textfile
+//                            collector of node_exporter) never to read half of one,
+//                            stderr without it
+class StatsDumper {
+public:
+    // called from the dumper's thread, IReliable::stats() is safe to call from there
+    using Snapshot = std::function<ReliableStats()>;
+
+    // labels go on every prometheus sample
+    StatsDumper(Snapshot snapshot, std::string labels);
+
+    ~StatsDumper();
+
+    StatsDumper(const StatsDumper &) = delete;
+
+    StatsDumper &operator=(const StatsDumper &) = delete;
+
+private:
+    Snapshot snapshot;
+    std::string labels;
+    std::string format;
+    std::string path;
+    std::chrono::milliseconds interval{1000};
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+
+    void dump();
+};
+
+#endif //RELIABLE_OVER_UDP_RELIABLE_STATS_H
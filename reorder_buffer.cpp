@@ -0,0 +1,19 @@
+#include <algorithm>
+#include "reorder_buffer.h"
+
+ReorderBuffer::ReorderBuffer(uint32_t capacity)
+        : slots((std::min)(capacity, static_cast<uint32_t>(MAX_SACK_SLICES))) {}
+
+bool ReorderBuffer::insert(PacketPtr packet) {
+    uint32_t seq = packet->num;
+    if (seq < next || seq - next >= slots.size()) {
+        return false;
+    }
+
+    if (scoreboard.mark(seq) != SackScoreboard::Mark::NEW) {
+        return false;
+    }
+
+    slots[seq % slots.size()] = std::move(packet);
+    return true;
+}
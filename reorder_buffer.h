@@ -0,0 +1,57 @@
+#ifndef RELIABLE_OVER_UDP_REORDER_BUFFER_H
+#define RELIABLE_OVER_UDP_REORDER_BUFFER_H
+
+#include <cstdint>
+#include <vector>
+#include "packet.h"
+#include "sack.h"
+
+// receive side buffer for slices which arrive ahead of a gap,
+// a ring of capacity slots, the slot of seq is seq % capacity
+//
+// slices are handed out in order once the gap fills,
+// its scoreboard tells the sender what is held (see makeSack())
+class ReorderBuffer {
+    std::vector<PacketPtr> slots;
+    SackScoreboard scoreboard;
+    // next seq to hand out
+    uint32_t next = 0;
+public:
+    constexpr static uint32_t defaultCapacity = 256;
+
+    explicit ReorderBuffer(uint32_t capacity = defaultCapacity);
+
+    // keep a DATA packet, false if it is a duplicate or beyond the buffer
+    bool insert(PacketPtr packet);
+
+    // hand every slice which is now in order to f, one by one
+    template <typename F>
+    void deliver(F &&f) {
+        while (true) {
+            PacketPtr &slot = slots[next % slots.size()];
+            if (!slot || slot->num != next) {
+                break;
+            }
+            f(*slot);
+            slot.reset();
+            next++;
+        }
+    }
+
+    // the next seq expected in order
+    uint32_t expected() const {
+        return next;
+    }
+
+    // whether slices wait behind a gap
+    bool hasHoles() const {
+        return scoreboard.hasHoles();
+    }
+
+    // the window is what the buffer holds from the next expected seq on
+    PacketPtr makeSack() const {
+        return scoreboard.makeSack(static_cast<uint32_t>(slots.size()));
+    }
+};
+
+#endif //RELIABLE_OVER_UDP_REORDER_BUFFER_H
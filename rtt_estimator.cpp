@@ -0,0 +1,31 @@
+#include <algorithm>
+#include <cstdlib>
+#include "rtt_estimator.h"
+
+void RttEstimator::sample(Duration rtt) {
+    int64_t r = (std::max)(rtt.count(), int64_t(1));
+    int64_t srtt = srttNs.load(std::memory_order_relaxed);
+    int64_t rttvar = rttvarNs.load(std::memory_order_relaxed);
+
+    if (srtt == 0) {
+        // first measurement
+        srtt = r;
+        rttvar = r / 2;
+    } else {
+        // beta = 1/4, alpha = 1/8
+        rttvar = rttvar - rttvar / 4 + std::abs(srtt - r) / 4;
+        srtt = srtt - srtt / 8 + r / 8;
+    }
+
+    int64_t rto = srtt + (std::max)(Duration(granularity).count(), 4 * rttvar);
+    rto = std::clamp(rto, Duration(minRto).count(), Duration(maxRto).count());
+
+    srttNs.store(srtt, std::memory_order_relaxed);
+    rttvarNs.store(rttvar, std::memory_order_relaxed);
+    rtoNs.store(rto, std::memory_order_relaxed);
+}
+
+void RttEstimator::backoff() {
+    int64_t rto = rtoNs.load(std::memory_order_relaxed);
+    rtoNs.store((std::min)(rto * 2, Duration(maxRto).count()), std::memory_order_relaxed);
+}
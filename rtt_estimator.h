@@ -0,0 +1,49 @@
+#ifndef RELIABLE_OVER_UDP_RTT_ESTIMATOR_H
+#define RELIABLE_OVER_UDP_RTT_ESTIMATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// retransmission timeout estimation, RFC 6298
+//
+// the windows feed it with round trip samples of slices which were sent
+// exactly once (Karn's algorithm) and call backoff() on every timeout,
+// which doubles the RTO until the next valid sample.
+// updates come from the thread driving the session,
+// reads are allowed from any thread
+class RttEstimator {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    // the old fixed timeout, used until the first sample arrives
+    constexpr static Duration initialRto = std::chrono::milliseconds(50);
+    constexpr static Duration minRto = std::chrono::milliseconds(1);
+    constexpr static Duration maxRto = std::chrono::seconds(60);
+    // clock granularity G
+    constexpr static Duration granularity = std::chrono::microseconds(100);
+
+    void sample(Duration rtt);
+
+    void backoff();
+
+    Duration rto() const {
+        return Duration(rtoNs.load(std::memory_order_relaxed));
+    }
+
+    // zero until the first sample
+    Duration srtt() const {
+        return Duration(srttNs.load(std::memory_order_relaxed));
+    }
+
+    Duration rttvar() const {
+        return Duration(rttvarNs.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<int64_t> srttNs = 0;
+    std::atomic<int64_t> rttvarNs = 0;
+    std::atomic<int64_t> rtoNs = Duration(initialRto).count();
+};
+
+#endif //RELIABLE_OVER_UDP_RTT_ESTIMATOR_H
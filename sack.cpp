@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <cstring>
+#include "sack.h"
+
+SackScoreboard::Mark SackScoreboard::mark(uint32_t seq) {
+    if (seq < cumAck) {
+        return Mark::DUPLICATE;
+    }
+    if (seq - cumAck > MAX_SACK_SLICES) {
+        return Mark::OUT_OF_RANGE;
+    }
+
+    uint8_t &bit = bits[seq % bits.size()];
+    if (bit) {
+        return Mark::DUPLICATE;
+    }
+    bit = 1;
+    highest = (std::max)(highest, seq + 1);
+
+    // fill the hole, clear the bits behind the cumulative ack for reuse
+    while (bits[cumAck % bits.size()]) {
+        bits[cumAck % bits.size()] = 0;
+        cumAck++;
+    }
+    highest = (std::max)(highest, cumAck);
+
+    return Mark::NEW;
+}
+
+bool SackScoreboard::received(uint32_t seq) const {
+    return seq < cumAck || (seq - cumAck <= MAX_SACK_SLICES && bits[seq % bits.size()]);
+}
+
+PacketPtr SackScoreboard::makeSack(uint32_t window) const {
+    // the window, then bits for cumAck + 1 .. highest - 1
+    uint32_t count = highest > cumAck + 1 ? highest - cumAck - 1 : 0;
+    uint32_t bytes = ROUND_UP(count, 8) / 8;
+    uint8_t payload[sizeof(uint32_t) + MAX_SACK_BYTES];
+    memcpy(payload, &window, sizeof(window));
+    uint8_t *bitmap = payload + sizeof(window);
+    memset(bitmap, 0, bytes);
+    for (uint32_t i = 0; i < count; i++) {
+        if (bits[(cumAck + 1 + i) % bits.size()]) {
+            bitmap[i / 8] |= 1 << (i % 8);
+        }
+    }
+
+    return PacketHelper::makePacket(PacketType::SACK, cumAck, payload, sizeof(window) + bytes);
+}
@@ -0,0 +1,42 @@
+#ifndef RELIABLE_OVER_UDP_SACK_H
+#define RELIABLE_OVER_UDP_SACK_H
+
+#include <cstdint>
+#include <vector>
+#include "packet.h"
+
+// receiver side record of the slices which arrived,
+// what a SACK packet is built from
+//
+// every seq below cumAck() has arrived, above it a ring of bits
+// covers the next MAX_SACK_SLICES sequence numbers
+class SackScoreboard {
+    uint32_t cumAck = 0;
+    // highest seq marked so far + 1, or cumAck when nothing is above it
+    uint32_t highest = 0;
+    std::vector<uint8_t> bits = std::vector<uint8_t>(MAX_SACK_SLICES + 1);
+public:
+    enum class Mark {
+        NEW,
+        DUPLICATE,
+        OUT_OF_RANGE,
+    };
+
+    Mark mark(uint32_t seq);
+
+    uint32_t cumulative() const {
+        return cumAck;
+    }
+
+    // whether anything above the cumulative ack has arrived (a hole exists)
+    bool hasHoles() const {
+        return highest > cumAck;
+    }
+
+    bool received(uint32_t seq) const;
+
+    // window: slices from the cumulative ack on the receiver takes
+    PacketPtr makeSack(uint32_t window) const;
+};
+
+#endif //RELIABLE_OVER_UDP_SACK_H
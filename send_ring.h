@@ -0,0 +1,99 @@
+#ifndef RELIABLE_OVER_UDP_SEND_RING_H
+#define RELIABLE_OVER_UDP_SEND_RING_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "packet.h"
+
+// sender side window of GBN and RENO, the slices in flight in a fixed
+// ring indexed by seq, nothing is allocated per slice
+//
+// the session appends at end() and retires from base(), both on the
+// thread driving it, so there is no lock and no atomic, an entry stays
+// where it is until it is retired, pointers to its slice may be kept
+// for a batched send
+class SendRing {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        PacketSlice slice;
+        Clock::time_point sentAt;
+        bool retransmitted;
+        bool sacked;
+    };
+
+private:
+    std::vector<Entry> entries;
+    const uint32_t mask;
+
+    uint32_t baseSeq;
+    uint32_t endSeq;
+
+    static uint32_t roundUp(uint32_t n) {
+        uint32_t capacity = 1;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+public:
+    // room for at least capacity slices, the first one is seq first
+    SendRing(uint32_t capacity, uint32_t first)
+            : entries(roundUp(capacity)),
+              mask(static_cast<uint32_t>(entries.size()) - 1),
+              baseSeq(first),
+              endSeq(first) {}
+
+    uint32_t capacity() const {
+        return mask + 1;
+    }
+
+    // first seq still in flight
+    uint32_t base() const {
+        return baseSeq;
+    }
+
+    // first seq not appended yet
+    uint32_t end() const {
+        return endSeq;
+    }
+
+    uint32_t size() const {
+        return endSeq - baseSeq;
+    }
+
+    bool empty() const {
+        return endSeq == baseSeq;
+    }
+
+    bool contains(uint32_t seq) const {
+        return seq - baseSeq < endSeq - baseSeq;
+    }
+
+    // the entry of seq end(), while size() < capacity()
+    Entry &append(const Entry &entry) {
+        Entry &slot = entries[endSeq & mask];
+        slot = entry;
+        endSeq++;
+        return slot;
+    }
+
+    // an entry in [base(), end())
+    Entry &at(uint32_t seq) {
+        return entries[seq & mask];
+    }
+
+    const Entry &at(uint32_t seq) const {
+        return entries[seq & mask];
+    }
+
+    // everything below seq is acknowledged
+    void retire(uint32_t seq) {
+        baseSeq = seq;
+    }
+};
+
+#endif //RELIABLE_OVER_UDP_SEND_RING_H
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include "log.h"
+#include "session.h"
+
+SenderSession::SenderSession(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source,
+                             uint32_t window, std::unique_ptr<ICongestionControl> congestion)
+        : dataSize(transport.packetSize() - sizeof(Packet)),
+          transport(transport), timers(timers), rtt(rtt), source(source), congestion(std::move(congestion)),
+          fixedWindow(window), stats(transport.stats()) {
+    uint64_t slices = (source.size() + dataSize - 1) / dataSize;
+    if (slices > UINT32_MAX) {
+        LOG_ERROR << "too large to send: " << source.size() << " bytes" << std::endl;
+        state = State::FAILED;
+        return;
+    }
+    end = static_cast<uint32_t>(slices);
+}
+
+SenderSession::~SenderSession() {
+    timers.cancel(finTimer);
+    timers.cancel(paceTimer);
+}
+
+void SenderSession::start() {
+    if (finished()) {
+        return;
+    }
+    if (end == 0) {
+        close();
+        return;
+    }
+    countWindow();
+    onStart();
+}
+
+void SenderSession::onPacket(PacketPtr packet) {
+    if (packet->type == PacketType::SYN) {
+        // our SYN_ACK got lost, the peer is still waiting for it (maybe
+        // probing a smaller size by now), the size agreed stays
+        LOG_DEBUG << "received SYN again, sending SYN_ACK" << std::endl;
+        transport.send(PacketHelper::makePacket(PacketType::SYN_ACK, transport.packetSize()));
+    } else if (state == State::SENDING && packet->type == PacketType::SACK) {
+        if (stats && heardSack && packet->num == peerAcked && packet->num < next) {
+            stats->duplicateAck();
+        }
+        heardSack = true;
+        // a SACK overtaken by a later one tells nothing new about the window
+        if (packet->num >= peerAcked) {
+            peerAcked = packet->num;
+            peerWindow = PacketHelper::sackWindow(*packet);
+        }
+        onSack(*packet);
+    } else if (state == State::CLOSING && packet->type == PacketType::FIN_ACK) {
+        LOG_DEBUG << "received FIN_ACK" << std::endl;
+        timers.cancel(finTimer);
+        finTimer = 0;
+        state = State::CLOSED;
+    }
+}
+
+uint32_t SenderSession::sourceWindow() const {
+    uint64_t slices = source.capacity() / dataSize;
+    return static_cast<uint32_t>(std::clamp<uint64_t>(slices, 1, UINT32_MAX));
+}
+
+uint32_t SenderSession::sendWindow() const {
+    uint32_t limit = congestion ? (std::min)(congestion->window(), ICongestionControl::maxWindow) : fixedWindow;
+    return (std::max)((std::min)(limit, sourceWindow()), 1u);
+}
+
+using Seconds = std::chrono::duration<double>;
+
+// a fixed window is paced a little faster than window per srtt, so the
+// pacer never holds back what the window allows
+const static double fixedPacingGain = 1.2;
+
+double SenderSession::pacingRate() const {
+    // what a round trip is taken to be: the srtt, but the rto before the
+    // first sample and from a timeout until the next sample, the rto backs
+    // off on every timeout, so a window too large for the path goes out
+    // slower each time instead of overflowing the same queue again
+    bool estimated = rtt.srtt() > RttEstimator::Duration::zero() && !backedOff;
+    double roundTrip = Seconds(estimated ? rtt.srtt() : rtt.rto()).count();
+    double rate = 0;
+    if (congestion) {
+        rate = congestion->pacingRate();
+    } else {
+        rate = fixedPacingGain * sendWindow() / roundTrip;
+    }
+
+    // resends are spread over one round trip at most, so they are out
+    // about when the timer which queued them could go off again
+    if (!resends.empty()) {
+        rate = (std::max)(rate, static_cast<double>(resends.size()) / roundTrip);
+    }
+
+    uint64_t cap = Pacer::maxRate();
+    if (cap > 0) {
+        double capped = static_cast<double>(cap) / transport.packetSize();
+        rate = rate > 0 ? (std::min)(rate, capped) : capped;
+    }
+    return rate;
+}
+
+uint32_t SenderSession::take(uint32_t wanted) {
+    auto now = timers.now();
+    pacer.setRate(pacingRate());
+    uint32_t granted = pacer.take(now, wanted);
+    if (granted < wanted && paceTimer == 0) {
+        paceTimer = timers.schedule(pacer.nextAt(now), [this] {
+            paceTimer = 0;
+            if (state == State::SENDING) {
+                flushResends();
+                onPaced();
+            }
+        });
+    }
+    return granted;
+}
+
+uint32_t SenderSession::paced(uint32_t wanted) {
+    flushResends();
+
+    // nothing beyond what the receiver takes
+    uint64_t limit = static_cast<uint64_t>(peerAcked) + peerWindow;
+    wanted = next < limit ? static_cast<uint32_t>((std::min)(static_cast<uint64_t>(wanted), limit - next)) : 0;
+    if (!resends.empty() || wanted == 0) {
+        return 0;
+    }
+    return take(wanted);
+}
+
+void SenderSession::resend(uint32_t seq, ConnectionStats::Retransmit reason) {
+    // queued twice, it is still the first reason which sends it
+    resends.emplace(seq, reason);
+}
+
+void SenderSession::flushResends() {
+    // what was acked while it waited is not sent at all
+    for (auto it = resends.begin(); it != resends.end();) {
+        it = unacked(it->first) == nullptr ? resends.erase(it) : std::next(it);
+    }
+    if (resends.empty()) {
+        return;
+    }
+
+    uint32_t granted = take(static_cast<uint32_t>(resends.size()));
+    resending.clear();
+    uint32_t fast = 0;
+    for (auto it = resends.begin(); granted-- > 0;) {
+        resending.push_back(unacked(it->first));
+        fast += it->second == ConnectionStats::Retransmit::FAST;
+        it = resends.erase(it);
+    }
+    if (resending.empty()) {
+        return;
+    }
+    transport.send(resending);
+    if (stats) {
+        stats->retransmitted(ConnectionStats::Retransmit::FAST, fast);
+        stats->retransmitted(ConnectionStats::Retransmit::TIMEOUT, resending.size() - fast);
+    }
+}
+
+void SenderSession::congestionAck(uint32_t acked, uint32_t inFlight, ITimerService::Clock::duration sample) {
+    if (congestion) {
+        congestion->onAck({timers.now(), acked, inFlight, sample, rtt.srtt()});
+    }
+    if (sample > ITimerService::Clock::duration::zero()) {
+        backedOff = false;
+        if (stats) {
+            stats->rttSample(sample);
+        }
+    }
+    countWindow();
+}
+
+void SenderSession::congestionLoss(uint32_t seq) {
+    // every loss of one window is one congestion event
+    if (!congestion || seq < recoveryPoint) {
+        return;
+    }
+    recoveryPoint = next;
+    congestion->onLoss(timers.now());
+    countWindow();
+}
+
+void SenderSession::congestionTimeout() {
+    if (!congestion) {
+        return;
+    }
+    recoveryPoint = next;
+    congestion->onTimeout(timers.now());
+    countWindow();
+}
+
+PacketSlice SenderSession::slice(uint32_t seq) {
+    uint64_t offset = static_cast<uint64_t>(seq) * dataSize;
+    uint32_t sliceLen = (std::min)(source.size() - offset, static_cast<uint64_t>(dataSize));
+
+    // the window sends (and resends) straight from the source's memory
+    return PacketHelper::makeSlice(seq, source.acquire(offset, sliceLen), sliceLen);
+}
+
+void SenderSession::acknowledged(uint32_t cumAck) {
+    // everything below the cumulative ack is never sent again
+    source.release(static_cast<uint64_t>(cumAck) * dataSize);
+    retries = 0;
+}
+
+bool SenderSession::retry() {
+    rtt.backoff();
+    backedOff = true;
+    return ++retries <= maxRetries;
+}
+
+void SenderSession::close() {
+    LOG_DEBUG << "sent all slices, closing" << std::endl;
+    state = State::CLOSING;
+    retries = 0;
+    sendFin();
+}
+
+void SenderSession::fail() {
+    LOG_WARN << "peer does not answer, giving up" << std::endl;
+    timers.cancel(finTimer);
+    finTimer = 0;
+    state = State::FAILED;
+}
+
+void SenderSession::countWindow() {
+    if (!stats) {
+        return;
+    }
+    if (congestion) {
+        stats->window(congestion->window(), congestion->slowStartThreshold());
+    } else {
+        stats->window(fixedWindow, 0);
+    }
+}
+
+void SenderSession::sendFin() {
+    LOG_DEBUG << "sending FIN" << std::endl;
+    transport.send(PacketHelper::makePacket(PacketType::FIN));
+
+    finTimer = timers.schedule(timers.now() + rtt.rto(), [this] {
+        finTimer = 0;
+        if (retry()) {
+            sendFin();
+            return;
+        }
+        // every slice was acknowledged, only the goodbye got lost
+        LOG_WARN << "no FIN_ACK, closing anyway" << std::endl;
+        state = State::CLOSED;
+    });
+}
+
+ReceiverSession::ReceiverSession(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy)
+        : transport(transport), timers(timers), sink(sink), ackPolicy(ackPolicy) {}
+
+ReceiverSession::~ReceiverSession() {
+    timers.cancel(idleTimer);
+    timers.cancel(ackTimer);
+}
+
+void ReceiverSession::start() {
+    lastHeard = timers.now();
+    armIdleTimer();
+}
+
+void ReceiverSession::onPacket(PacketPtr packet) {
+    if (done) {
+        return;
+    }
+    lastHeard = timers.now();
+
+    if (packet->type == PacketType::DATA) {
+        onData(std::move(packet));
+    } else if (packet->type == PacketType::FIN) {
+        LOG_DEBUG << "received FIN, sending FIN_ACK" << std::endl;
+        transport.send(PacketHelper::makePacket(PacketType::FIN_ACK));
+        timers.cancel(idleTimer);
+        idleTimer = 0;
+        timers.cancel(ackTimer);
+        ackTimer = 0;
+        done = true;
+    } else {
+        LOG_TRACE << "received unexpected packet" << std::endl;
+    }
+}
+
+void ReceiverSession::fail() {
+    timers.cancel(idleTimer);
+    idleTimer = 0;
+    timers.cancel(ackTimer);
+    ackTimer = 0;
+    done = true;
+    failed = true;
+}
+
+void ReceiverSession::acknowledge(bool urgent) {
+    if (urgent || ++unacked >= ackPolicy.every) {
+        sendAck();
+        return;
+    }
+    if (ackTimer == 0) {
+        ackTimer = timers.schedule(timers.now() + ackPolicy.delay, [this] {
+            ackTimer = 0;
+            sendAck();
+        });
+    }
+}
+
+void ReceiverSession::sendAck() {
+    timers.cancel(ackTimer);
+    ackTimer = 0;
+    unacked = 0;
+    transport.send(makeSack());
+}
+
+void ReceiverSession::armIdleTimer() {
+    // re-armed from when the peer was last heard of, not on every packet
+    idleTimer = timers.schedule(lastHeard + idleTimeout, [this] {
+        idleTimer = 0;
+        if (timers.now() - lastHeard < idleTimeout) {
+            armIdleTimer();
+            return;
+        }
+        LOG_WARN << "peer silent for too long, giving up" << std::endl;
+        fail();
+    });
+}
+
+OrderedReceiver::OrderedReceiver(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy)
+        : ReceiverSession(transport, timers, sink, ackPolicy) {}
+
+void OrderedReceiver::onData(PacketPtr packet) {
+    // keep slices ahead of a gap, hand out whatever is in order now
+    bool failed = false;
+    bool gap = reorder.hasHoles();
+    bool inserted = reorder.insert(std::move(packet));
+    if (inserted) {
+        reorder.deliver([&](const Packet &slice) {
+            LOG_TRACE << "received slice " << slice.num << std::endl;
+
+            uint32_t sliceLen = slice.len - sizeof(Packet);
+            if (!failed && !sink.write(bytes, slice.data, sliceLen)) {
+                failed = true;
+            }
+            bytes += sliceLen;
+        });
+    }
+    if (failed) {
+        LOG_ERROR << "failed to write slice" << std::endl;
+        fail();
+        return;
+    }
+
+    acknowledge(!inserted || gap || reorder.hasHoles());
+}
+
+PacketPtr OrderedReceiver::makeSack() const {
+    LOG_TRACE << "sending SACK " << reorder.expected() << std::endl;
+    return reorder.makeSack();
+}
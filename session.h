@@ -0,0 +1,297 @@
+#ifndef RELIABLE_OVER_UDP_SESSION_H
+#define RELIABLE_OVER_UDP_SESSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include "packet.h"
+#include "transport.h"
+#include "rtt_estimator.h"
+#include "reliable_stats.h"
+#include "stream.h"
+#include "reorder_buffer.h"
+#include "congestion.h"
+#include "pacer.h"
+
+// one shot timers, every callback runs on the thread driving the session,
+// id 0 is never handed out, so it can stand for "no timer"
+class ITimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+
+    virtual Clock::time_point now() const = 0;
+
+    virtual TimerId schedule(Clock::time_point when, std::function<void()> callback) = 0;
+
+    // ids of timers which fired or were cancelled already are ignored
+    virtual void cancel(TimerId id) = 0;
+
+    virtual ~ITimerService() = default;
+};
+
+// one end of a transfer as a state machine, driven by packets from its
+// peer and by its timers, it never blocks
+//
+// whoever drives it calls start() once, then onPacket() for every valid
+// packet until finished() turns true
+class ISession {
+public:
+    virtual void start() = 0;
+
+    virtual void onPacket(PacketPtr packet) = 0;
+
+    virtual bool finished() const = 0;
+
+    // everything was delivered, meaningful once finished
+    virtual bool succeeded() const = 0;
+
+    virtual ~ISession() = default;
+};
+
+// what every sender shares: cutting the source into slices, pacing them
+// onto the wire and closing with FIN / FIN_ACK, the window is up to the
+// protocol, or to a congestion controller if it was given one
+//
+// the pacer spreads slices at the controller's pacing rate, or a bit
+// above window / srtt without one (window / rto before the first sample
+// and after a timeout), below the rate cap (see Pacer), resends queue
+// up and go before any new slice
+//
+// it counts resends, duplicate acks, its window and the rtt samples into
+// the ConnectionStats of its transport, if that has any
+//
+// the sender is the accepting side, a SYN of its peer means the SYN_ACK
+// got lost, it is answered again with the packet size agreed before
+class SenderSession : public ISession {
+public:
+    // payload of a full slice, from the packet size of the transport
+    const uint32_t dataSize;
+    // consecutive timeouts without progress before the peer is given up
+    const static uint32_t maxRetries = 10;
+
+    // window: slices in flight without a controller
+    SenderSession(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source,
+                  uint32_t window, std::unique_ptr<ICongestionControl> congestion = nullptr);
+
+    ~SenderSession() override;
+
+    void start() override;
+
+    void onPacket(PacketPtr packet) override;
+
+    bool finished() const override {
+        return state == State::CLOSED || state == State::FAILED;
+    }
+
+    bool succeeded() const override {
+        return state == State::CLOSED;
+    }
+
+protected:
+    ITransport &transport;
+    ITimerService &timers;
+    RttEstimator &rtt;
+    ISource &source;
+    // nullptr for a fixed window
+    std::unique_ptr<ICongestionControl> congestion;
+
+    // slices in the whole transfer
+    uint32_t end = 0;
+    // next seq to send the first time
+    uint32_t next = 0;
+
+    // the source holds no more than this many unreleased slices
+    uint32_t sourceWindow() const;
+
+    // slices allowed in flight: the controller's window, or the fixed one
+    uint32_t sendWindow() const;
+
+    // how many of wanted new slices the pacer lets go now, none while
+    // resends wait or beyond the receive window of the last SACK, for
+    // the rest onPaced() is called once they may go
+    uint32_t paced(uint32_t wanted);
+
+    // queue seq to be sent again, lower seqs go first
+    void resend(uint32_t seq, ConnectionStats::Retransmit reason);
+
+    // send what the pacer lets go of the queued resends
+    void flushResends();
+
+    // tell the controller about a SACK: slices newly acked (0 for a
+    // duplicate), slices still in flight and the rtt sample, zero for none
+    void congestionAck(uint32_t acked, uint32_t inFlight, ITimerService::Clock::duration sample);
+
+    // seq was found lost, the controller hears of it once per window
+    void congestionLoss(uint32_t seq);
+
+    void congestionTimeout();
+
+    // the slice of seq, acquired from the source
+    PacketSlice slice(uint32_t seq);
+
+    // every seq below cumAck is delivered: release it from the source,
+    // the retry count starts over
+    void acknowledged(uint32_t cumAck);
+
+    // a timeout, backs the rto off, false once the peer is given up
+    bool retry();
+
+    // every slice is acknowledged, send FIN
+    void close();
+
+    // give up on the peer
+    void fail();
+
+    // send the first window, the transfer has at least one slice
+    virtual void onStart() = 0;
+
+    // only while slices are in flight
+    virtual void onSack(const Packet &sack) = 0;
+
+    // the pacer lets more slices go
+    virtual void onPaced() = 0;
+
+    // the slice of a queued resend, nullptr if it was acked meanwhile
+    virtual const PacketSlice *unacked(uint32_t seq) = 0;
+
+private:
+    enum class State {
+        SENDING,
+        CLOSING,
+        CLOSED,
+        FAILED,
+    };
+
+    State state = State::SENDING;
+    uint32_t retries = 0;
+    // a timeout backed the rto off, no sample came since
+    bool backedOff = false;
+    ITimerService::TimerId finTimer = 0;
+
+    const uint32_t fixedWindow;
+
+    // nullptr if the transport counts nothing
+    ConnectionStats *const stats;
+
+    Pacer pacer;
+    ITimerService::TimerId paceTimer = 0;
+    // what each resend is for, counted once it goes
+    std::map<uint32_t, ConnectionStats::Retransmit> resends;
+    std::vector<const PacketSlice *> resending;
+    // losses below this seq belong to a window the controller reacted to
+    uint32_t recoveryPoint = 0;
+    // the latest cumulative ack and the receive window it came with,
+    // nothing limits the first window
+    uint32_t peerAcked = 0;
+    uint32_t peerWindow = UINT32_MAX;
+    // a SACK with the same cumulative ack as the last one is a duplicate
+    bool heardSack = false;
+
+    void sendFin();
+
+    // tell the stats what the window is now
+    void countWindow();
+
+    // slices per second the pacer lets go now
+    double pacingRate() const;
+
+    // how many of wanted slices may go now, if not all, a timer goes off
+    // once the next may
+    uint32_t take(uint32_t wanted);
+};
+
+// when a receiver sends its SACK: once every slices arrived, or delay
+// after the first it has not acked yet, whichever comes first, and at
+// once for a slice out of order, one filling a gap or a duplicate, so
+// the sender learns of a loss as soon as it can
+struct AckPolicy {
+    uint32_t every = 2;
+    // well below the minimum rto, see RttEstimator
+    ITimerService::Clock::duration delay = std::chrono::microseconds(500);
+};
+
+// what every receiver shares: acknowledging as its AckPolicy says,
+// answering FIN and giving up on a silent peer
+class ReceiverSession : public ISession {
+public:
+    // a peer silent this long is given up
+    constexpr static auto idleTimeout = std::chrono::seconds(30);
+
+    ReceiverSession(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy = {});
+
+    ~ReceiverSession() override;
+
+    void start() override;
+
+    void onPacket(PacketPtr packet) override;
+
+    bool finished() const override {
+        return done;
+    }
+
+    bool succeeded() const override {
+        return done && !failed;
+    }
+
+    // bytes written to the sink
+    virtual uint64_t received() const = 0;
+
+protected:
+    ITransport &transport;
+    ITimerService &timers;
+    ISink &sink;
+
+    // stop with an error, e.g. the sink failed
+    void fail();
+
+    // a DATA was handled, urgent if it was out of order, filled a gap or
+    // was a duplicate, the SACK goes now or later as the policy says
+    void acknowledge(bool urgent);
+
+    virtual void onData(PacketPtr packet) = 0;
+
+    // what the receiver holds, with its receive window
+    virtual PacketPtr makeSack() const = 0;
+
+private:
+    bool done = false;
+    bool failed = false;
+    ITimerService::Clock::time_point lastHeard;
+    ITimerService::TimerId idleTimer = 0;
+
+    const AckPolicy ackPolicy;
+    // slices arrived since the last SACK
+    uint32_t unacked = 0;
+    ITimerService::TimerId ackTimer = 0;
+
+    void armIdleTimer();
+
+    void sendAck();
+};
+
+// the receiver of GBN and RENO: hands slices to the sink in order,
+// slices ahead of a gap wait in a reorder buffer, a slice out of order,
+// filling a gap or a duplicate is acked at once, so the sender gets a
+// duplicate cumulative ack plus the slices held above the gap
+class OrderedReceiver : public ReceiverSession {
+    ReorderBuffer reorder;
+    uint64_t bytes = 0;
+
+public:
+    OrderedReceiver(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy = {});
+
+    uint64_t received() const override {
+        return bytes;
+    }
+
+protected:
+    void onData(PacketPtr packet) override;
+
+    PacketPtr makeSack() const override;
+};
+
+#endif //RELIABLE_OVER_UDP_SESSION_H
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <utility>
+#include "log.h"
+#include "session_GBN.h"
+
+SenderGBN::SenderGBN(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source, uint32_t N,
+                     std::unique_ptr<ICongestionControl> congestion)
+        : SenderSession(transport, timers, rtt, source, N, std::move(congestion)),
+          window(this->congestion ? ICongestionControl::maxWindow : N, 0) {}
+
+SenderGBN::~SenderGBN() {
+    timers.cancel(timer);
+}
+
+void SenderGBN::onStart() {
+    fill();
+}
+
+void SenderGBN::onPaced() {
+    fill();
+}
+
+void SenderGBN::fill() {
+    uint32_t limit = (std::min)(sendWindow(), window.capacity());
+    uint32_t count = window.size() < limit ? (std::min)(limit - window.size(), end - next) : 0;
+    count = paced(count);
+
+    // everything new in one batch
+    flushing.clear();
+    while (count-- > 0) {
+        LOG_TRACE << "sent packet " << next << std::endl;
+        flushing.push_back(&window.append({slice(next), timers.now(), false, false}).slice);
+        next++;
+    }
+    if (flushing.empty()) {
+        return;
+    }
+    transport.send(flushing);
+
+    if (timer == 0) {
+        restartTimer();
+    }
+}
+
+void SenderGBN::restartTimer() {
+    timers.cancel(timer);
+    timer = 0;
+    if (!window.empty()) {
+        timer = timers.schedule(timers.now() + rtt.rto(), [this] { onTimeout(); });
+    }
+}
+
+void SenderGBN::onTimeout() {
+    timer = 0;
+    LOG_DEBUG << "timeout, rto = " << rtt.rto().count() << " ns" << std::endl;
+    if (!retry()) {
+        fail();
+        return;
+    }
+    resendAll();
+    congestionTimeout();
+    restartTimer();
+}
+
+// go back N: resend the whole window, paced,
+// but skip what the receiver already holds
+void SenderGBN::resendAll() {
+    for (uint32_t seq = window.base(); seq < window.end(); seq++) {
+        auto &entry = window.at(seq);
+        if (entry.sacked) {
+            continue;
+        }
+        entry.retransmitted = true;
+        resend(seq, ConnectionStats::Retransmit::TIMEOUT);
+    }
+    flushResends();
+}
+
+const PacketSlice *SenderGBN::unacked(uint32_t seq) {
+    if (!window.contains(seq) || window.at(seq).sacked) {
+        return nullptr;
+    }
+    return &window.at(seq).slice;
+}
+
+void SenderGBN::onSack(const Packet &sack) {
+    uint32_t ack = (std::min)(sack.num, next);
+    LOG_TRACE << "received ack " << sack.num << std::endl;
+
+    for (uint32_t seq = (std::max)(ack + 1, window.base()); seq < window.end(); seq++) {
+        if (PacketHelper::isSacked(sack, seq)) {
+            window.at(seq).sacked = true;
+        }
+    }
+
+    if (window.base() >= ack) {
+        congestionAck(0, window.size(), Clock::duration::zero());
+        return;
+    }
+
+    // Karn's algorithm, no sample if any acked slice was sent twice
+    uint32_t acked = ack - window.base();
+    bool ambiguous = false;
+    for (uint32_t seq = window.base(); seq < ack; seq++) {
+        ambiguous |= window.at(seq).retransmitted;
+    }
+    Clock::duration sample = Clock::duration::zero();
+    if (!ambiguous) {
+        sample = timers.now() - window.at(ack - 1).sentAt;
+        rtt.sample(sample);
+    }
+    window.retire(ack);
+    congestionAck(acked, window.size(), sample);
+    LOG_TRACE << "move window to " << ack << std::endl;
+
+    acknowledged(ack);
+    restartTimer();
+
+    if (ack == end) {
+        close();
+    } else {
+        fill();
+    }
+}
+
+ReceiverGBN::ReceiverGBN(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy)
+        : OrderedReceiver(transport, timers, sink, ackPolicy) {}
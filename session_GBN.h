@@ -0,0 +1,54 @@
+#ifndef RELIABLE_OVER_UDP_SESSION_GBN_H
+#define RELIABLE_OVER_UDP_SESSION_GBN_H
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "session.h"
+#include "send_ring.h"
+
+// go back N: one timer for the oldest slice in flight, which resends
+// the whole window (but what was SACKed) when it expires, the window is
+// N slices or what a congestion controller allows
+class SenderGBN : public SenderSession {
+    using Clock = ITimerService::Clock;
+
+    // window, the slices in [base, next), room for N or the largest
+    // window a controller may ask for
+    SendRing window;
+    std::vector<const PacketSlice *> flushing;
+
+    ITimerService::TimerId timer = 0;
+
+    // send new slices until the window is full
+    void fill();
+
+    void restartTimer();
+
+    void onTimeout();
+
+    void resendAll();
+
+public:
+    SenderGBN(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source, uint32_t N,
+              std::unique_ptr<ICongestionControl> congestion = nullptr);
+
+    ~SenderGBN() override;
+
+protected:
+    void onStart() override;
+
+    void onSack(const Packet &sack) override;
+
+    void onPaced() override;
+
+    const PacketSlice *unacked(uint32_t seq) override;
+};
+
+// hands slices out in order, see OrderedReceiver
+class ReceiverGBN : public OrderedReceiver {
+public:
+    ReceiverGBN(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy = {});
+};
+
+#endif //RELIABLE_OVER_UDP_SESSION_GBN_H
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <utility>
+#include "log.h"
+#include "session_RENO.h"
+
+SenderRENO::SenderRENO(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source,
+                       std::unique_ptr<ICongestionControl> congestion)
+        : SenderSession(transport, timers, rtt, source, ICongestionControl::maxWindow,
+                        congestion ? std::move(congestion) : std::make_unique<RenoControl>()),
+          window(ICongestionControl::maxWindow, 0) {}
+
+SenderRENO::~SenderRENO() {
+    timers.cancel(timer);
+}
+
+void SenderRENO::onStart() {
+    fill();
+}
+
+void SenderRENO::onPaced() {
+    fill();
+}
+
+void SenderRENO::fill() {
+    uint32_t limit = (std::min)(sendWindow(), window.capacity());
+    uint32_t count = window.size() < limit ? (std::min)(limit - window.size(), end - next) : 0;
+    count = paced(count);
+
+    // everything new in one batch
+    flushing.clear();
+    while (count-- > 0) {
+        LOG_TRACE << "sent packet " << next << std::endl;
+        flushing.push_back(&window.append({slice(next), timers.now(), false, false}).slice);
+        next++;
+    }
+    if (flushing.empty()) {
+        return;
+    }
+    transport.send(flushing);
+
+    if (timer == 0) {
+        restartTimer();
+    }
+}
+
+void SenderRENO::restartTimer() {
+    timers.cancel(timer);
+    timer = 0;
+    if (!window.empty()) {
+        timer = timers.schedule(timers.now() + rtt.rto(), [this] { onTimeout(); });
+    }
+}
+
+void SenderRENO::onTimeout() {
+    timer = 0;
+    LOG_DEBUG << "timeout, rto = " << rtt.rto().count() << " ns" << std::endl;
+    if (!retry()) {
+        fail();
+        return;
+    }
+    resendHoles(next, ConnectionStats::Retransmit::TIMEOUT);
+
+    congestionTimeout();
+    duplicateCnt = 0;
+    prevAck = -1;
+
+    restartTimer();
+}
+
+void SenderRENO::resendHoles(uint32_t limit, ConnectionStats::Retransmit reason) {
+    for (uint32_t seq = window.base(); seq < (std::min)(limit, window.end()); seq++) {
+        auto &entry = window.at(seq);
+        if (!entry.sacked) {
+            entry.retransmitted = true;
+            resend(seq, reason);
+        }
+    }
+    flushResends();
+}
+
+const PacketSlice *SenderRENO::unacked(uint32_t seq) {
+    if (!window.contains(seq) || window.at(seq).sacked) {
+        return nullptr;
+    }
+    return &window.at(seq).slice;
+}
+
+void SenderRENO::onSack(const Packet &sack) {
+    uint32_t ack = (std::min)(sack.num, next);
+    LOG_TRACE << "received ack " << sack.num << std::endl;
+
+    // remember what the receiver holds above the cumulative ack
+    uint32_t highestSacked = ack;
+    for (uint32_t seq = (std::max)(ack + 1, window.base()); seq < window.end(); seq++) {
+        if (PacketHelper::isSacked(sack, seq)) {
+            window.at(seq).sacked = true;
+            highestSacked = seq;
+        }
+    }
+
+    // slide the window over what is delivered
+    uint32_t acked = 0;
+    Clock::duration sample = Clock::duration::zero();
+    if (window.base() < ack) {
+        // Karn's algorithm, no sample if any acked slice was sent twice
+        acked = ack - window.base();
+        bool ambiguous = false;
+        for (uint32_t seq = window.base(); seq < ack; seq++) {
+            ambiguous |= window.at(seq).retransmitted;
+        }
+        if (!ambiguous) {
+            sample = timers.now() - window.at(ack - 1).sentAt;
+            rtt.sample(sample);
+        }
+        window.retire(ack);
+        LOG_TRACE << "move window to " << ack << std::endl;
+
+        acknowledged(ack);
+        restartTimer();
+    }
+
+    // fast retransmit
+    if (ack == prevAck) {
+        duplicateCnt++;
+
+        if (duplicateCnt == 3) {
+            congestionLoss(ack);
+
+            // the first missing slice, plus every other hole below the highest SACKed one
+            LOG_DEBUG << "fast retransmit" << std::endl;
+            resendHoles((std::max)(highestSacked, ack + 1), ConnectionStats::Retransmit::FAST);
+        } else {
+            congestionAck(0, window.size(), sample);
+        }
+    } else {
+        duplicateCnt = 0;
+        congestionAck(acked, window.size(), sample);
+    }
+    prevAck = ack;
+
+    if (window.base() == end) {
+        close();
+        return;
+    }
+
+    // send next packets
+    fill();
+}
+
+ReceiverRENO::ReceiverRENO(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy)
+        : OrderedReceiver(transport, timers, sink, ackPolicy) {}
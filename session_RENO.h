@@ -0,0 +1,59 @@
+#ifndef RELIABLE_OVER_UDP_SESSION_RENO_H
+#define RELIABLE_OVER_UDP_SESSION_RENO_H
+
+#include <memory>
+#include <vector>
+#include "session.h"
+#include "send_ring.h"
+
+// a go back N window under congestion control, Reno unless given another
+// controller: fast retransmit after 3 duplicate acks, resending only the
+// holes the receiver reports
+class SenderRENO : public SenderSession {
+    using Clock = ITimerService::Clock;
+
+    // for fast retransmit
+    uint32_t prevAck = -1;
+    uint32_t duplicateCnt = 0;
+
+    // window, the slices in [base, next), room for the largest window a
+    // controller may ask for
+    SendRing window;
+    std::vector<const PacketSlice *> flushing;
+
+    ITimerService::TimerId timer = 0;
+
+    // send new slices until the congestion window is full
+    void fill();
+
+    void restartTimer();
+
+    void onTimeout();
+
+    // resend every slice below limit the receiver has not SACKed, paced
+    void resendHoles(uint32_t limit, ConnectionStats::Retransmit reason);
+
+public:
+    // without a controller it runs RenoControl
+    SenderRENO(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source,
+               std::unique_ptr<ICongestionControl> congestion = nullptr);
+
+    ~SenderRENO() override;
+
+protected:
+    void onStart() override;
+
+    void onSack(const Packet &sack) override;
+
+    void onPaced() override;
+
+    const PacketSlice *unacked(uint32_t seq) override;
+};
+
+// the GBN receiver, see OrderedReceiver
+class ReceiverRENO : public OrderedReceiver {
+public:
+    ReceiverRENO(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy = {});
+};
+
+#endif //RELIABLE_OVER_UDP_SESSION_RENO_H
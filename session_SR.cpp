@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <utility>
+#include "log.h"
+#include "session_SR.h"
+
+SenderSR::SenderSR(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source, uint32_t N,
+                   std::unique_ptr<ICongestionControl> congestion)
+        : SenderSession(transport, timers, rtt, source, N, std::move(congestion)),
+          entries(this->congestion ? ICongestionControl::maxWindow : N), slots(entries.size()) {}
+
+SenderSR::~SenderSR() {
+    timers.cancel(timer);
+}
+
+void SenderSR::onStart() {
+    fill();
+}
+
+void SenderSR::onPaced() {
+    fill();
+    armTimer();
+}
+
+void SenderSR::fill() {
+    // a window shrunk by the controller still counts what is acked above base
+    uint32_t limit = (std::min)({sendWindow() + ackedAbove, slots, sourceWindow()});
+    uint32_t count = next - base < limit ? (std::min)(limit - (next - base), end - next) : 0;
+    count = paced(count);
+    auto now = timers.now();
+    auto deadline = now + rtt.rto();
+
+    flushing.clear();
+    while (count-- > 0) {
+        LOG_TRACE << "sending slice " << next << std::endl;
+        Entry &entry = entries[next % slots];
+        entry = {slice(next), now, false, false, false};
+        flushing.push_back(&entry.slice);
+        deadlines.push({deadline, next});
+        next++;
+    }
+    if (flushing.empty()) {
+        return;
+    }
+
+    transport.send(flushing);
+    armTimer();
+}
+
+void SenderSR::armTimer() {
+    // drop what is acked already, so it does not wake us up for nothing
+    while (!deadlines.empty() &&
+           (deadlines.top().seq < base || entries[deadlines.top().seq % slots].acked)) {
+        deadlines.pop();
+    }
+
+    Clock::time_point earliest = deadlines.empty() ? Clock::time_point::max() : deadlines.top().when;
+    if (earliest == armedFor) {
+        return;
+    }
+
+    timers.cancel(timer);
+    timer = 0;
+    armedFor = earliest;
+    if (earliest != Clock::time_point::max()) {
+        timer = timers.schedule(earliest, [this] { onTimeout(); });
+    }
+}
+
+void SenderSR::onTimeout() {
+    timer = 0;
+    armedFor = Clock::time_point::max();
+
+    // queue everything which is due, the pacer spreads it out
+    auto now = timers.now();
+    expired.clear();
+    bool stalled = false;
+    while (!deadlines.empty() && deadlines.top().when <= now) {
+        uint32_t seq = deadlines.top().seq;
+        deadlines.pop();
+
+        Entry &entry = entries[seq % slots];
+        if (seq < base || entry.acked) {
+            continue;
+        }
+
+        LOG_TRACE << "timeout, resending slice " << seq << std::endl;
+        entry.retransmitted = true;
+        resend(seq, ConnectionStats::Retransmit::TIMEOUT);
+        expired.push_back(seq);
+        stalled = stalled || seq == base;
+    }
+
+    if (!expired.empty()) {
+        // one backoff per expiry of the oldest slice, however many slices
+        // it covers, a large window expires in many batches behind it,
+        // and at most one per rto, like a single timer: slices resent in
+        // one batch expire one after the other as the base moves on
+        if (stalled && now >= backedOffUntil) {
+            LOG_DEBUG << "timeout, rto = " << rtt.rto().count() << " ns" << std::endl;
+            if (!retry()) {
+                fail();
+                return;
+            }
+            congestionTimeout();
+            backedOffUntil = now + rtt.rto();
+        }
+        auto deadline = now + rtt.rto();
+        for (uint32_t seq: expired) {
+            deadlines.push({deadline, seq});
+        }
+        flushResends();
+    }
+
+    armTimer();
+}
+
+void SenderSR::onSack(const Packet &sack) {
+    // newly acked slices, the most recently sent one gives the rtt sample
+    uint32_t scanEnd = (std::min)(next, sack.num + 1 + MAX_SACK_SLICES);
+    uint32_t sacked = 0;
+    bool sample = false;
+    Clock::time_point sentAt;
+    for (uint32_t seq = base; seq < scanEnd; seq++) {
+        Entry &entry = entries[seq % slots];
+        if (entry.acked || !PacketHelper::isSacked(sack, seq)) {
+            continue;
+        }
+        entry.acked = true;
+        sacked++;
+        ackedAbove++;
+
+        // Karn's algorithm, a resent slice gives no sample
+        if (!entry.retransmitted && (!sample || entry.sentAt > sentAt)) {
+            sample = true;
+            sentAt = entry.sentAt;
+        }
+    }
+    Clock::duration sampled = Clock::duration::zero();
+    if (sample) {
+        sampled = timers.now() - sentAt;
+        rtt.sample(sampled);
+    }
+    congestionAck(sacked, next - base - ackedAbove, sampled);
+    if (sacked > 0) {
+        LOG_TRACE << "sack " << sack.num << " acked " << sacked << " slices" << std::endl;
+    }
+
+    // holes with at least dupThresh SACKed slices above them are lost,
+    // resend them now instead of waiting for their deadline
+    uint32_t above = 0;
+    for (uint32_t seq = scanEnd; seq-- > base;) {
+        Entry &entry = entries[seq % slots];
+        if (entry.acked) {
+            above++;
+        } else if (above >= dupThresh && !entry.fastRetransmitted) {
+            LOG_TRACE << "fast retransmit slice " << seq << std::endl;
+            congestionLoss(seq);
+            entry.retransmitted = true;
+            entry.fastRetransmitted = true;
+            resend(seq, ConnectionStats::Retransmit::FAST);
+            deadlines.push({timers.now() + rtt.rto(), seq});
+        }
+    }
+    flushResends();
+
+    // try to move window
+    if (base < next && entries[base % slots].acked) {
+        while (base < next && entries[base % slots].acked) {
+            base++;
+            ackedAbove--;
+        }
+        LOG_TRACE << "move window to " << base << std::endl;
+        acknowledged(base);
+
+        if (base == end) {
+            timers.cancel(timer);
+            timer = 0;
+            close();
+            return;
+        }
+    }
+
+    // a controller may open the window without the base moving
+    fill();
+    armTimer();
+}
+
+const PacketSlice *SenderSR::unacked(uint32_t seq) {
+    Entry &entry = entries[seq % slots];
+    if (seq < base || seq >= next || entry.acked) {
+        return nullptr;
+    }
+    return &entry.slice;
+}
+
+ReceiverSR::ReceiverSR(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy)
+        : ReceiverSession(transport, timers, sink, ackPolicy), dataSize(transport.packetSize() - sizeof(Packet)) {}
+
+void ReceiverSR::onData(PacketPtr packet) {
+    LOG_TRACE << "received slice " << packet->num << std::endl;
+
+    // a slice too far ahead to be reported is dropped, it is resent later
+    bool gap = scoreboard.hasHoles();
+    bool marked = scoreboard.mark(packet->num) == SackScoreboard::Mark::NEW;
+    if (marked) {
+        // straight to its final offset, no matter the order
+        uint64_t offset = static_cast<uint64_t>(packet->num) * dataSize;
+        uint32_t sliceLen = packet->len - sizeof(Packet);
+        if (!sink.write(offset, packet->data, sliceLen)) {
+            LOG_ERROR << "failed to write slice" << std::endl;
+            fail();
+            return;
+        }
+        bytes = (std::max)(bytes, offset + sliceLen);
+    }
+
+    acknowledge(!marked || gap || scoreboard.hasHoles());
+}
+
+PacketPtr ReceiverSR::makeSack() const {
+    LOG_TRACE << "sending SACK " << scoreboard.cumulative() << std::endl;
+    // the scoreboard reaches this far above the cumulative ack
+    return scoreboard.makeSack(MAX_SACK_SLICES);
+}
@@ -0,0 +1,105 @@
+#ifndef RELIABLE_OVER_UDP_SESSION_SR_H
+#define RELIABLE_OVER_UDP_SESSION_SR_H
+
+#include <memory>
+#include <queue>
+#include <vector>
+#include "session.h"
+#include "sack.h"
+
+// selective repeat: every slice has its own retransmission deadline,
+// all of them in one min-heap behind a single timer, a hole with enough
+// SACKed slices above it is resent at once, the window is N slices or
+// what a congestion controller allows
+class SenderSR : public SenderSession {
+    using Clock = ITimerService::Clock;
+
+    // per slice state, slot of seq is seq % slots
+    struct Entry {
+        PacketSlice slice;
+        Clock::time_point sentAt;
+        bool acked;
+        bool retransmitted;
+        bool fastRetransmitted;
+    };
+
+    // retransmission deadline of one slice
+    struct Deadline {
+        Clock::time_point when;
+        uint32_t seq;
+
+        bool operator>(const Deadline &other) const {
+            return when > other.when;
+        }
+    };
+
+    // window, the slices in [base, next)
+    uint32_t base = 0;
+    std::vector<Entry> entries;
+    // N, or the largest window a controller may ask for
+    const uint32_t slots;
+    // slices acked above base
+    uint32_t ackedAbove = 0;
+
+    // a deadline of an already acked slice is dropped when it pops
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines;
+    // new slices sent in one batch
+    std::vector<const PacketSlice *> flushing;
+    // slices whose deadline passed together
+    std::vector<uint32_t> expired;
+
+    ITimerService::TimerId timer = 0;
+    Clock::time_point armedFor = Clock::time_point::max();
+    // a stall before this was answered by the last backoff already
+    Clock::time_point backedOffUntil;
+
+    // send new slices until the window is full
+    void fill();
+
+    // follow the earliest deadline
+    void armTimer();
+
+    void onTimeout();
+
+public:
+    // a slice is resent at once when this many slices above it were SACKed
+    const static uint32_t dupThresh = 3;
+
+    SenderSR(ITransport &transport, ITimerService &timers, RttEstimator &rtt, ISource &source, uint32_t N,
+             std::unique_ptr<ICongestionControl> congestion = nullptr);
+
+    ~SenderSR() override;
+
+protected:
+    void onStart() override;
+
+    void onSack(const Packet &sack) override;
+
+    void onPaced() override;
+
+    const PacketSlice *unacked(uint32_t seq) override;
+};
+
+// writes every slice straight to its final offset, no matter the order,
+// SACKs go out as the AckPolicy says
+class ReceiverSR : public ReceiverSession {
+    // payload of a full slice, the sender cuts at the same size
+    const uint32_t dataSize;
+    SackScoreboard scoreboard;
+    uint64_t bytes = 0;
+
+public:
+    ReceiverSR(ITransport &transport, ITimerService &timers, ISink &sink, AckPolicy ackPolicy = {});
+
+    // the end of the furthest slice written
+    uint64_t received() const override {
+        return bytes;
+    }
+
+protected:
+    void onData(PacketPtr packet) override;
+
+    PacketPtr makeSack() const override;
+};
+
+#endif //RELIABLE_OVER_UDP_SESSION_SR_H
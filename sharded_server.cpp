@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include "log.h"
+#include "sharded_server.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// the cores this process may run on, from its affinity mask, so a
+// server started under taskset or in a cpuset only pins to those
+static std::vector<int> allowedCores() {
+    std::vector<int> cores;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int core = 0; core < CPU_SETSIZE; core++) {
+            if (CPU_ISSET(core, &set)) {
+                cores.push_back(core);
+            }
+        }
+    } else {
+        LOG_WARN << "sched_getaffinity() failed: " << errno << std::endl;
+    }
+#endif
+    if (cores.empty()) {
+        unsigned count = (std::max)(std::thread::hardware_concurrency(), 1u);
+        for (unsigned core = 0; core < count; core++) {
+            cores.push_back(static_cast<int>(core));
+        }
+    }
+    return cores;
+}
+
+// pin the calling thread
+static void pinToCore(int core) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        LOG_WARN << "failed to pin worker to core " << core << ": " << error << std::endl;
+    }
+#endif
+}
+
+ShardedServer::ShardedServer(uint16_t port, int workers, const Dispatcher::Factory &factory,
+                             const Dispatcher::Opener &opener) {
+    if (workers < 1) {
+        throw std::invalid_argument("at least one worker is needed");
+    }
+
+    for (int i = 0; i < workers; i++) {
+        shards.push_back(std::make_unique<Dispatcher>(port, factory, opener, workers > 1));
+    }
+}
+
+void ShardedServer::run() {
+    if (shards.size() == 1) {
+        shards[0]->run();
+        return;
+    }
+
+    std::vector<int> cores = allowedCores();
+    LOG_INFO << "serving with " << shards.size() << " workers on " << cores.size() << " cores" << std::endl;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < shards.size(); i++) {
+        int core = cores[i % cores.size()];
+        threads.emplace_back([this, i, core] {
+            pinToCore(core);
+            shards[i]->run();
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void ShardedServer::stop() {
+    for (auto &shard: shards) {
+        shard->stop();
+    }
+}
+
+ReliableStats ShardedServer::stats() const {
+    ReliableStats total;
+    for (auto &shard: shards) {
+        StatsHelper::accumulate(total, shard->stats());
+    }
+    return total;
+}
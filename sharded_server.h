@@ -0,0 +1,35 @@
+#ifndef RELIABLE_OVER_UDP_SHARDED_SERVER_H
+#define RELIABLE_OVER_UDP_SHARDED_SERVER_H
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include "dispatcher.h"
+
+// one Dispatcher per worker, each with its own SO_REUSEPORT socket on the
+// same port and its own sessions, so workers share no locks
+//
+// worker i runs pinned to core i (mod the core count), together with
+// every session of its shard, so a session never leaves its core
+class ShardedServer {
+    std::vector<std::unique_ptr<Dispatcher>> shards;
+public:
+    // a single worker binds a plain socket and is not pinned
+    ShardedServer(uint16_t port, int workers, const Dispatcher::Factory &factory,
+                  const Dispatcher::Opener &opener);
+
+    int workers() const {
+        return static_cast<int>(shards.size());
+    }
+
+    // serve until stop() is called
+    void run();
+
+    // safe to call from any thread
+    void stop();
+
+    // the counters of every shard summed, see Dispatcher::stats()
+    ReliableStats stats() const;
+};
+
+#endif //RELIABLE_OVER_UDP_SHARDED_SERVER_H
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "congestion.h"
+#include "session_GBN.h"
+#include "session_SR.h"
+#include "session_RENO.h"
+#include "simulator.h"
+
+// sweep of the protocols over simulated links, on a virtual clock
+// program.exe [sizeMB] [seeds] [rate Mbit] [threads]
+// every protocol, window and congestion control runs over every loss and
+// rtt, seeds times with different random losses, on a bottleneck of rate
+// (0 for none) with a 256 KB queue, one CSV line per transfer on stdout
+
+struct Protocol {
+    std::string name;
+    Congestion congestion;
+    // slices in flight without a controller, 0 for the protocol's own
+    uint32_t window;
+};
+
+struct Case {
+    Protocol protocol;
+    double loss;
+    double rttMs;
+    uint64_t seed;
+};
+
+static SimulatorHelper::SenderFactory senderOf(const Protocol &protocol) {
+    return [protocol](ITransport &transport, ITimerService &timers, RttEstimator &rtt,
+                      ISource &source) -> std::unique_ptr<ISession> {
+        auto congestion = CongestionHelper::create(protocol.congestion);
+        if (protocol.name == "GBN") {
+            return std::make_unique<SenderGBN>(transport, timers, rtt, source, protocol.window, std::move(congestion));
+        } else if (protocol.name == "SR") {
+            return std::make_unique<SenderSR>(transport, timers, rtt, source, protocol.window, std::move(congestion));
+        }
+        return std::make_unique<SenderRENO>(transport, timers, rtt, source, std::move(congestion));
+    };
+}
+
+static SimulatorHelper::ReceiverFactory receiverOf(const Protocol &protocol) {
+    return [protocol](ITransport &transport, ITimerService &timers, ISink &sink) -> std::unique_ptr<ReceiverSession> {
+        if (protocol.name == "GBN") {
+            return std::make_unique<ReceiverGBN>(transport, timers, sink);
+        } else if (protocol.name == "SR") {
+            return std::make_unique<ReceiverSR>(transport, timers, sink);
+        }
+        return std::make_unique<ReceiverRENO>(transport, timers, sink);
+    };
+}
+
+static const char *nameOf(Congestion congestion) {
+    switch (congestion) {
+        case Congestion::NONE:
+            return "none";
+        case Congestion::RENO:
+            return "reno";
+        case Congestion::CUBIC:
+            return "cubic";
+        case Congestion::BBR:
+            return "bbr";
+    }
+    return "unknown";
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t size = (argc > 1 ? std::stoull(argv[1]) : 4) * 1024 * 1024;
+    int seeds = argc > 2 ? std::stoi(argv[2]) : 3;
+    double rateMbit = argc > 3 ? std::stod(argv[3]) : 100;
+    int threads = argc > 4 ? std::stoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+    threads = (std::max)(threads, 1);
+
+    Log::setLevel(LogLevel::ERR);
+
+    std::vector<Protocol> protocols;
+    for (const char *name: {"GBN", "SR"}) {
+        for (uint32_t window: {4u, 16u, 64u, 256u}) {
+            protocols.push_back({name, Congestion::NONE, window});
+        }
+        for (Congestion congestion: {Congestion::RENO, Congestion::CUBIC, Congestion::BBR}) {
+            protocols.push_back({name, congestion, 0});
+        }
+    }
+    for (Congestion congestion: {Congestion::RENO, Congestion::CUBIC, Congestion::BBR}) {
+        protocols.push_back({"RENO", congestion, 0});
+    }
+
+    std::vector<Case> cases;
+    for (const Protocol &protocol: protocols) {
+        for (double loss: {0.0, 0.001, 0.01, 0.02, 0.05}) {
+            for (double rttMs: {1.0, 10.0, 50.0, 100.0}) {
+                for (int seed = 1; seed <= seeds; seed++) {
+                    cases.push_back({protocol, loss, rttMs, static_cast<uint64_t>(seed)});
+                }
+            }
+        }
+    }
+
+    // transfers are independent, each thread takes the next one
+    std::vector<SimulationResult> results(cases.size());
+    std::atomic<size_t> nextCase = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back([&] {
+            for (size_t index = nextCase++; index < cases.size(); index = nextCase++) {
+                const Case &c = cases[index];
+                SimulationSetup setup;
+                setup.size = size;
+                for (ImpairmentConfig *link: {&setup.forward, &setup.backward}) {
+                    link->loss = c.loss;
+                    link->delay = std::chrono::duration_cast<ImpairmentConfig::Duration>(
+                            std::chrono::duration<double, std::milli>(c.rttMs / 2));
+                    link->rate = static_cast<uint64_t>(rateMbit * 1000 * 1000 / 8);
+                }
+                setup.forward.seed = c.seed * 2;
+                setup.backward.seed = c.seed * 2 + 1;
+                results[index] = SimulatorHelper::simulate(setup, senderOf(c.protocol), receiverOf(c.protocol));
+            }
+        });
+    }
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "protocol,congestion,window,loss,rtt_ms,seed,succeeded,seconds,goodput_mbit,"
+                 "retransmission_ratio,acks,events" << std::endl;
+    for (size_t i = 0; i < cases.size(); i++) {
+        const Case &c = cases[i];
+        const SimulationResult &r = results[i];
+        std::cout << c.protocol.name << "," << nameOf(c.protocol.congestion) << "," << c.protocol.window << ","
+                  << c.loss << "," << c.rttMs << "," << c.seed << "," << r.succeeded << ","
+                  << std::chrono::duration<double>(r.elapsed).count() << ","
+                  << r.goodput() * 8 / 1000 / 1000 << "," << r.retransmissionRatio() << ","
+                  << r.acksSent << "," << r.events << std::endl;
+    }
+    std::cerr << cases.size() << " transfers simulated in " << elapsed << " s" << std::endl;
+    return 0;
+}
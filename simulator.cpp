@@ -0,0 +1,160 @@
+#include <cstring>
+#include <vector>
+#include "simulator.h"
+
+using Seconds = std::chrono::duration<double>;
+
+// every slice of the transfer is the same run of zeros
+class ZeroSource : public ISource {
+    uint64_t len;
+    std::vector<uint8_t> zeros = std::vector<uint8_t>(MAX_PACKET_SIZE);
+public:
+    explicit ZeroSource(uint64_t len) : len(len) {}
+
+    uint64_t size() const override {
+        return len;
+    }
+
+    const uint8_t *acquire(uint64_t, uint32_t) override {
+        return zeros.data();
+    }
+
+    void release(uint64_t) override {}
+};
+
+// the receivers count what they get themselves
+class DiscardSink : public ISink {
+public:
+    bool write(uint64_t, const uint8_t *, uint32_t) override {
+        return true;
+    }
+};
+
+VirtualClock::TimerId VirtualClock::schedule(Clock::time_point when, std::function<void()> callback) {
+    TimerId id = ++lastId;
+    callbacks.emplace(id, std::move(callback));
+    deadlines.push({when, id});
+    return id;
+}
+
+void VirtualClock::cancel(TimerId id) {
+    callbacks.erase(id);
+}
+
+bool VirtualClock::step() {
+    while (!deadlines.empty()) {
+        Deadline deadline = deadlines.top();
+        deadlines.pop();
+
+        auto it = callbacks.find(deadline.id);
+        if (it == callbacks.end()) {
+            continue;
+        }
+        // a timer scheduled in the past fires now, time never runs backwards
+        current = (std::max)(current, deadline.when);
+        auto callback = std::move(it->second);
+        callbacks.erase(it);
+        firedCount++;
+        callback();
+        return true;
+    }
+    return false;
+}
+
+SimulatedLink::SimulatedLink(VirtualClock &clock, const ImpairmentConfig &config, uint32_t packetSize)
+        : clock(clock), impairment(config), maxPacketSize(packetSize) {}
+
+void SimulatedLink::carry(const Packet &header, const uint8_t *data) {
+    sent.datagrams++;
+    sent.bytes += header.len;
+    if (header.type == PacketType::DATA) {
+        sent.data++;
+    }
+
+    auto verdict = impairment.pass(clock.now(), header.len);
+    for (int i = 0; i < verdict.copies; i++) {
+        auto packet = PacketPool::allocate();
+        memcpy(packet.get(), &header, sizeof(Packet));
+        if (data != nullptr) {
+            memcpy(packet->data, data, header.len - sizeof(Packet));
+        }
+
+        uint64_t key = ++lastKey;
+        inFlight.emplace(key, std::move(packet));
+        clock.schedule(verdict.arrival[i], [this, key] {
+            auto it = inFlight.find(key);
+            PacketPtr packet = std::move(it->second);
+            inFlight.erase(it);
+            if (peer != nullptr && !peer->finished()) {
+                peer->onPacket(std::move(packet));
+            }
+        });
+    }
+}
+
+bool SimulatedLink::send(const PacketPtr &packet) {
+    carry(*packet, packet->data);
+    return true;
+}
+
+bool SimulatedLink::send(const PacketSlice &slice) {
+    carry(slice.header, slice.data);
+    return true;
+}
+
+int SimulatedLink::send(std::span<const PacketSlice *const> slices) {
+    for (const PacketSlice *slice: slices) {
+        carry(slice->header, slice->data);
+    }
+    return static_cast<int>(slices.size());
+}
+
+double SimulationResult::goodput() const {
+    double seconds = Seconds(elapsed).count();
+    return seconds > 0 ? static_cast<double>(received) / seconds : 0;
+}
+
+double SimulationResult::retransmissionRatio() const {
+    return slices > 0 ? static_cast<double>(dataSent - slices) / static_cast<double>(slices) : 0;
+}
+
+SimulationResult SimulatorHelper::simulate(const SimulationSetup &setup, const SenderFactory &makeSender,
+                                           const ReceiverFactory &makeReceiver) {
+    // the clock goes last, the sessions cancel their timers on the way out
+    VirtualClock clock;
+    SimulatedLink forward(clock, setup.forward, setup.packetSize);
+    SimulatedLink backward(clock, setup.backward, setup.packetSize);
+
+    ZeroSource source(setup.size);
+    DiscardSink sink;
+    RttEstimator rtt;
+    auto sender = makeSender(forward, clock, rtt, source);
+    auto receiver = makeReceiver(backward, clock, sink);
+    forward.connect(*receiver);
+    backward.connect(*sender);
+
+    auto start = clock.now();
+    auto limit = start + std::chrono::duration_cast<ITimerService::Clock::duration>(setup.limit);
+    auto doneAt = limit;
+    bool delivered = false;
+    receiver->start();
+    sender->start();
+    // the sender may still wait for its FIN_ACK once the receiver is done
+    while (!(sender->finished() && receiver->finished()) && clock.now() < limit && clock.step()) {
+        if (!delivered && receiver->finished()) {
+            delivered = true;
+            doneAt = clock.now();
+        }
+    }
+
+    uint32_t dataSize = setup.packetSize - sizeof(Packet);
+    SimulationResult result{};
+    result.succeeded = sender->succeeded() && receiver->succeeded() && receiver->received() == setup.size;
+    result.elapsed = doneAt - start;
+    result.received = receiver->received();
+    result.slices = (setup.size + dataSize - 1) / dataSize;
+    result.dataSent = forward.counters().data;
+    result.acksSent = backward.counters().datagrams;
+    result.events = clock.fired();
+    return result;
+}
@@ -0,0 +1,153 @@
+#ifndef RELIABLE_OVER_UDP_SIMULATOR_H
+#define RELIABLE_OVER_UDP_SIMULATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "packet.h"
+#include "transport.h"
+#include "rtt_estimator.h"
+#include "stream.h"
+#include "session.h"
+#include "impairment.h"
+
+// discrete-event simulation of a transfer: the same sessions the event
+// loop drives, on a virtual clock and over a simulated link, in one
+// thread and without sockets, time only moves from one event to the next,
+// so a transfer takes as long as its events take to handle
+
+// timers on a virtual clock, which jumps to each deadline as it fires
+class VirtualClock : public ITimerService {
+    struct Deadline {
+        Clock::time_point when;
+        TimerId id;
+
+        // ties go in the order they were scheduled
+        bool operator>(const Deadline &other) const {
+            return when != other.when ? when > other.when : id > other.id;
+        }
+    };
+
+    Clock::time_point current;
+    // a cancelled timer only leaves callbacks, its deadline is dropped when it pops
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines;
+    std::unordered_map<TimerId, std::function<void()>> callbacks;
+    TimerId lastId = 0;
+    uint64_t firedCount = 0;
+
+public:
+    Clock::time_point now() const override {
+        return current;
+    }
+
+    TimerId schedule(Clock::time_point when, std::function<void()> callback) override;
+
+    void cancel(TimerId id) override;
+
+    // move to the next deadline and run its callback, false if none is left
+    bool step();
+
+    // callbacks run so far
+    uint64_t fired() const {
+        return firedCount;
+    }
+};
+
+// one direction of a link, packets sent on it reach the peer session
+// when the Impairment says, if at all, the payload is copied at once, so
+// a slice may be reused as soon as send returns, like with a socket
+class SimulatedLink : public ITransport {
+public:
+    struct Counters {
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        // DATA packets, first sends and resends alike
+        uint64_t data = 0;
+    };
+
+private:
+    VirtualClock &clock;
+    Impairment impairment;
+    uint32_t maxPacketSize;
+    ISession *peer = nullptr;
+    Counters sent;
+    // packets on the wire
+    std::unordered_map<uint64_t, PacketPtr> inFlight;
+    uint64_t lastKey = 0;
+
+    void carry(const Packet &header, const uint8_t *data);
+
+public:
+    SimulatedLink(VirtualClock &clock, const ImpairmentConfig &config, uint32_t packetSize);
+
+    // where packets go, until it finished
+    void connect(ISession &session) {
+        peer = &session;
+    }
+
+    bool send(const PacketPtr &packet) override;
+
+    bool send(const PacketSlice &slice) override;
+
+    int send(std::span<const PacketSlice *const> slices) override;
+
+    uint32_t packetSize() const override {
+        return maxPacketSize;
+    }
+
+    const Counters &counters() const {
+        return sent;
+    }
+
+    const Impairment::Counters &impairments() const {
+        return impairment.counters();
+    }
+};
+
+struct SimulationSetup {
+    uint64_t size = 16 * 1024 * 1024;
+    uint32_t packetSize = MAX_PACKET_SIZE;
+    // what DATA crosses, and what SACKs cross back
+    ImpairmentConfig forward;
+    ImpairmentConfig backward;
+    // virtual time after which an unfinished transfer is given up
+    std::chrono::nanoseconds limit = std::chrono::hours(1);
+};
+
+struct SimulationResult {
+    bool succeeded;
+    // virtual time from the first slice until the receiver saw FIN
+    std::chrono::nanoseconds elapsed;
+    uint64_t received;
+    // slices in the transfer, and DATA packets it took
+    uint64_t slices;
+    uint64_t dataSent;
+    uint64_t acksSent;
+    uint64_t events;
+
+    // bytes per second of virtual time
+    double goodput() const;
+
+    // resends per slice
+    double retransmissionRatio() const;
+};
+
+namespace SimulatorHelper {
+    // builds the sending and the receiving session, like Dispatcher::Factory
+    using SenderFactory = std::function<std::unique_ptr<ISession>(ITransport &, ITimerService &,
+                                                                  RttEstimator &, ISource &)>;
+    using ReceiverFactory = std::function<std::unique_ptr<ReceiverSession>(ITransport &, ITimerService &,
+                                                                           ISink &)>;
+
+    // run one transfer of setup.size bytes to its end, the payload is all
+    // zeros and is not kept, only counted
+    SimulationResult simulate(const SimulationSetup &setup, const SenderFactory &makeSender,
+                              const ReceiverFactory &makeReceiver);
+}
+
+#endif //RELIABLE_OVER_UDP_SIMULATOR_H
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "log.h"
+#include "stream.h"
+#include "mmap_stream.h"
+
+bool MemorySink::write(uint64_t offset, const uint8_t *data, uint32_t sliceLen) {
+    if (offset + sliceLen > len) {
+        LOG_ERROR << "buffer overflow" << std::endl;
+        return false;
+    }
+
+    memcpy(buf + offset, data, sliceLen);
+    return true;
+}
+
+FileSource::FileSource(const std::string &filename, uint64_t capacity)
+        : file(filename, std::ios::binary), ringCapacity(capacity) {
+    if (!file.is_open()) {
+        return;
+    }
+
+    // the sender cuts the file into slices up front, so it needs the size,
+    // which a pipe or a terminal does not have
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    if (end < 0) {
+        LOG_ERROR << "cannot send " << filename << ": not seekable, its size is unknown" << std::endl;
+        file.close();
+        return;
+    }
+    fileSize = static_cast<uint64_t>(end);
+    file.seekg(0, std::ios::beg);
+}
+
+const uint8_t *FileSource::acquire(uint64_t offset, uint32_t len) {
+    // slices all have the length of the first one (but the last),
+    // a ring holding whole slices never splits one at the wrap around
+    if (ring.empty()) {
+        ring.resize((std::max)(static_cast<uint64_t>(len), ringCapacity - ringCapacity % len));
+    }
+    const uint64_t cap = ring.size();
+
+    // the sender's window stays within capacity(), waiting here for a
+    // release() would stall the very loop which delivers it
+    if (offset + len - released > cap) {
+        LOG_ERROR << "slice at " << offset << " does not fit the ring, released " << released << std::endl;
+        throw std::runtime_error("acquired beyond the ring");
+    }
+
+    while (readEnd < offset + len) {
+        uint64_t pos = readEnd % cap;
+        uint64_t chunk = (std::min)({cap - (readEnd - released), cap - pos, fileSize - readEnd});
+
+        file.read(reinterpret_cast<char *>(ring.data() + pos), static_cast<std::streamsize>(chunk));
+        if (!file) {
+            LOG_ERROR << "failed to read file at " << readEnd << std::endl;
+            throw std::runtime_error("failed to read file");
+        }
+        readEnd += chunk;
+    }
+
+    return ring.data() + offset % cap;
+}
+
+void FileSource::release(uint64_t offset) {
+    released = (std::max)(released, (std::min)(offset, readEnd));
+}
+
+FileSink::FileSink(const std::string &filename)
+        : file(filename, std::ios::binary) {}
+
+bool FileSink::write(uint64_t offset, const uint8_t *data, uint32_t len) {
+    if (offset != position) {
+        file.seekp(static_cast<std::streamoff>(offset));
+    }
+    file.write(reinterpret_cast<const char *>(data), len);
+    position = offset + len;
+
+    if (!file) {
+        LOG_ERROR << "failed to write file at " << offset << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<ISource> StreamHelper::openSource(const std::string &filename, uint64_t capacity) {
+#ifndef _WIN32
+    // fall through to streaming for whatever cannot be mapped, a file
+    // which is not seekable (like a pipe) is not opened by either
+    auto mapped = std::make_unique<MmapSource>(filename);
+    if (mapped->isOpen()) {
+        return mapped;
+    }
+#endif
+    auto file = std::make_unique<FileSource>(filename, capacity);
+    if (file->isOpen()) {
+        return file;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<ISink> StreamHelper::openSink(const std::string &filename) {
+#ifndef _WIN32
+    // fall through to streaming for whatever cannot be mapped, like /dev/null
+    auto mapped = std::make_unique<MmapSink>(filename);
+    if (mapped->isOpen()) {
+        return mapped;
+    }
+#endif
+    auto file = std::make_unique<FileSink>(filename);
+    if (file->isOpen()) {
+        return file;
+    }
+    return nullptr;
+}
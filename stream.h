@@ -0,0 +1,141 @@
+#ifndef RELIABLE_OVER_UDP_STREAM_H
+#define RELIABLE_OVER_UDP_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <memory>
+
+// where a sender takes its bytes from
+//
+// the sender acquires slices in increasing offset order and keeps
+// sending (and resending) straight from the returned memory until
+// the receiver has acknowledged them, then releases them, all on the
+// thread driving it
+class ISource {
+public:
+    virtual uint64_t size() const = 0;
+
+    // bytes [offset, offset + len), valid until release() passes them,
+    // every slice but the last has the same length, never more than
+    // capacity() bytes beyond the last release(), it never blocks
+    virtual const uint8_t *acquire(uint64_t offset, uint32_t len) = 0;
+
+    // every byte below offset has been delivered, lower values are ignored
+    virtual void release(uint64_t offset) = 0;
+
+    // bytes acquire() hands out before a release(),
+    // a sender keeps its window within this
+    virtual uint64_t capacity() const {
+        return UINT64_MAX;
+    }
+
+    virtual ~ISource() = default;
+};
+
+// where a receiver puts its bytes
+//
+// GBN and RENO write in order, SR writes each slice at its final offset
+class ISink {
+public:
+    virtual bool write(uint64_t offset, const uint8_t *data, uint32_t len) = 0;
+
+    // the transfer completed, a sink which kept its result out of sight
+    // until now (see MmapSink) makes it visible, false if that failed
+    virtual bool finish() {
+        return true;
+    }
+
+    virtual ~ISink() = default;
+};
+
+// a buffer which is already in memory, nothing is copied
+class MemorySource : public ISource {
+    const uint8_t *buf;
+    uint64_t len;
+public:
+    MemorySource(const uint8_t *buf, uint64_t len) : buf(buf), len(len) {}
+
+    uint64_t size() const override {
+        return len;
+    }
+
+    const uint8_t *acquire(uint64_t offset, uint32_t) override {
+        return buf + offset;
+    }
+
+    void release(uint64_t) override {}
+};
+
+class MemorySink : public ISink {
+    uint8_t *buf;
+    uint64_t len;
+public:
+    MemorySink(uint8_t *buf, uint64_t len) : buf(buf), len(len) {}
+
+    bool write(uint64_t offset, const uint8_t *data, uint32_t sliceLen) override;
+};
+
+// reads a file in chunks into a ring of capacity bytes,
+// so memory stays bounded by what is in flight
+//
+// only for a file with a size, one which cannot seek is not open
+class FileSource : public ISource {
+    std::ifstream file;
+    uint64_t fileSize = 0;
+    uint64_t ringCapacity;
+    std::vector<uint8_t> ring;
+
+    uint64_t readEnd = 0;   // file bytes read into the ring so far
+    uint64_t released = 0;  // file bytes the ring no longer holds
+public:
+    FileSource(const std::string &filename, uint64_t capacity);
+
+    bool isOpen() const {
+        return file.is_open();
+    }
+
+    uint64_t size() const override {
+        return fileSize;
+    }
+
+    const uint8_t *acquire(uint64_t offset, uint32_t len) override;
+
+    void release(uint64_t offset) override;
+
+    uint64_t capacity() const override {
+        return ringCapacity;
+    }
+};
+
+// writes every slice to its offset as it arrives
+class FileSink : public ISink {
+    std::ofstream file;
+    uint64_t position = 0;
+public:
+    explicit FileSink(const std::string &filename);
+
+    bool isOpen() const {
+        return file.is_open();
+    }
+
+    bool write(uint64_t offset, const uint8_t *data, uint32_t len) override;
+};
+
+namespace StreamHelper {
+
+    // a memory mapped file where the platform has it, else a FileSource
+    // reading through a ring of capacity bytes, nullptr if it cannot be
+    // opened or is not seekable (e.g. a pipe)
+    std::unique_ptr<ISource> openSource(const std::string &filename, uint64_t capacity);
+
+    // a memory mapped file where the platform and the file allow it (a
+    // regular file with room for the first step), else a FileSink,
+    // nullptr if it cannot be opened, call finish() once the transfer is
+    // complete, or the mapped file never appears under filename
+    std::unique_ptr<ISink> openSink(const std::string &filename);
+
+}
+
+#endif //RELIABLE_OVER_UDP_STREAM_H
@@ -0,0 +1,185 @@
+#ifndef RELIABLE_OVER_UDP_TASK_H
+#define RELIABLE_OVER_UDP_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "log.h"
+
+template <typename T = void>
+class Task;
+
+namespace TaskDetail {
+
+    struct PromiseBase {
+        // who co_awaits the task, resumed when it finishes
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+        std::exception_ptr exception;
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                return handle.promise().continuation;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        // lazy, nothing runs until the task is awaited
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void unhandled_exception() {
+            exception = std::current_exception();
+        }
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+
+        void return_value(T v) {
+            value.emplace(std::move(v));
+        }
+
+        T result() {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object();
+
+        void return_void() {}
+
+        void result() {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+
+    // owns itself, its frame goes away as soon as it finishes
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception() {
+                std::terminate();
+            }
+        };
+    };
+}
+
+// a lazily started coroutine returning T, co_await it to run it and get
+// its result, an exception thrown inside comes out of the co_await
+//
+// the awaiting coroutine is resumed straight from the final suspend point
+// (symmetric transfer), so long chains of tasks do not grow the stack
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = TaskDetail::Promise<T>;
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+            : handle(handle) {}
+
+    Task(Task &&obj) noexcept
+            : handle(std::exchange(obj.handle, nullptr)) {}
+
+    Task &operator=(Task &&obj) noexcept {
+        if (this != &obj) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(obj.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+
+    Task &operator=(const Task &) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept {
+                return handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() {
+                return handle.promise().result();
+            }
+        };
+        return Awaiter{handle};
+    }
+};
+
+template <typename T>
+Task<T> TaskDetail::Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskDetail::Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+namespace TaskHelper {
+
+    // run task up to its first suspension now, and let whatever it waits
+    // on resume it later, nobody awaits it, so an exception is only logged
+    inline TaskDetail::Detached spawn(Task<void> task) {
+        try {
+            co_await task;
+        } catch (const std::exception &e) {
+            LOG_ERROR << "task failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+#endif //RELIABLE_OVER_UDP_TASK_H
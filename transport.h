@@ -0,0 +1,31 @@
+#ifndef RELIABLE_OVER_UDP_TRANSPORT_H
+#define RELIABLE_OVER_UDP_TRANSPORT_H
+
+#include <span>
+#include "packet.h"
+
+class ConnectionStats;
+
+// where a session puts its packets, one peer
+class ITransport {
+public:
+    virtual bool send(const PacketPtr &packet) = 0;
+
+    // scatter/gather send, the payload is not copied
+    virtual bool send(const PacketSlice &slice) = 0;
+
+    // returns the number of slices sent
+    virtual int send(std::span<const PacketSlice *const> slices) = 0;
+
+    // the largest datagram the peer agreed to, a DATA packet never exceeds it
+    virtual uint32_t packetSize() const = 0;
+
+    // counters of the connection for the sessions to bump, nullptr if nobody counts
+    virtual ConnectionStats *stats() const {
+        return nullptr;
+    }
+
+    virtual ~ITransport() = default;
+};
+
+#endif //RELIABLE_OVER_UDP_TRANSPORT_H
@@ -1,7 +1,18 @@
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
 #include "log.h"
+#include "reliable_stats.h"
 #include "unreliable.h"
 
+#ifdef __linux__
+#include <netinet/udp.h>
+#elif !defined(_WIN32)
+#include <sys/select.h>
+#endif
+
+
 Unreliable::Unreliable(SOCKET s, const std::string &ip, uint16_t port) {
     this->s = s;
 
@@ -13,21 +24,40 @@ Unreliable::Unreliable(SOCKET s, const std::string &ip, uint16_t port) {
 Unreliable::Unreliable(SOCKET s)
         : Unreliable(s, "0.0.0.0", 0) {}
 
+Unreliable::Unreliable(SOCKET s, const sockaddr_in &remoteAddr, bool owned)
+        : s(s), remoteAddr(remoteAddr), owned(owned) {}
+
 Unreliable::Unreliable(Unreliable &&obj) {
     s = obj.s;
     remoteAddr = obj.remoteAddr;
+    owned = obj.owned;
+    maxPacketSize = obj.maxPacketSize;
+    counters = obj.counters;
+#ifdef __linux__
+    gso = obj.gso;
+    gro = obj.gro;
+    groTried = obj.groTried;
+#endif
     obj.s = INVALID_SOCKET;
 }
 
 Unreliable &Unreliable::operator=(Unreliable &&obj) {
     s = obj.s;
     remoteAddr = obj.remoteAddr;
+    owned = obj.owned;
+    maxPacketSize = obj.maxPacketSize;
+    counters = obj.counters;
+#ifdef __linux__
+    gso = obj.gso;
+    gro = obj.gro;
+    groTried = obj.groTried;
+#endif
     obj.s = INVALID_SOCKET;
     return *this;
 }
 
 Unreliable::~Unreliable() {
-    if (s != INVALID_SOCKET) {
+    if (s != INVALID_SOCKET && owned) {
         closesocket(s);
     }
 }
@@ -36,38 +66,65 @@ bool Unreliable::send(void *buf, int len) {
 
     int result = sendto(s, (char *) buf, len, 0, (sockaddr *) &remoteAddr, sizeof(remoteAddr));
     if (result == SOCKET_ERROR) {
-        LOG << "sendto() failed: " << WSAGetLastError() << std::endl;
+        int error = lastSocketError();
+#ifdef _WIN32
+        bool tooLarge = error == WSAEMSGSIZE;
+#else
+        bool tooLarge = error == EMSGSIZE;
+#endif
+        // expected while probing with the DF bit set
+        if (tooLarge) {
+            LOG_DEBUG << "sendto() failed, " << len << " bytes is more than the path carries" << std::endl;
+        } else {
+            LOG_ERROR << "sendto() failed: " << error << std::endl;
+        }
         return false;
     }
 
+    if (counters) {
+        counters->sent(1, len);
+    }
     return true;
 }
 
-bool Unreliable::send(const std::unique_ptr<Packet> &packet) {
+bool Unreliable::send(const PacketPtr &packet) {
     return send(packet.get(), packet->len);
 }
 
 bool Unreliable::recv(void *buf, int len) {
     sockaddr_in senderAddr;
-    int addr_len = sizeof(senderAddr);
+    socklen_t addr_len = sizeof(senderAddr);
     int result = recvfrom(s, (char *) buf, len, 0, (sockaddr *) &senderAddr, &addr_len);
     if (result == SOCKET_ERROR) {
-        LOG << "recvfrom() failed: " << WSAGetLastError() << std::endl;
+        LOG_ERROR << "recvfrom() failed: " << lastSocketError() << std::endl;
+        return false;
+    }
+
+    if (!acceptSender(senderAddr)) {
         return false;
     }
+    if (counters) {
+        counters->received(1, result);
+    }
+    return true;
+}
 
+bool Unreliable::acceptSender(const sockaddr_in &senderAddr) {
     // the first received packet
-    if (remoteAddr.sin_addr.s_addr == ADDR_ANY) {
+    if (remoteAddr.sin_addr.s_addr == INADDR_ANY) {
         remoteAddr = senderAddr;
-        LOG << "sender from : " << inet_ntoa(remoteAddr.sin_addr)
-            << ":" << ntohs(remoteAddr.sin_port) << std::endl;
+        LOG_INFO << "sender from : " << inet_ntoa(remoteAddr.sin_addr)
+                 << ":" << ntohs(remoteAddr.sin_port) << std::endl;
         return true;
     }
 
     // not the first time receive packet
     if (senderAddr.sin_addr.s_addr != remoteAddr.sin_addr.s_addr ||
         senderAddr.sin_port != remoteAddr.sin_port) {
-        LOG << "recvfrom() failed: sender address mismatch" << std::endl;
+        LOG_WARN << "recvfrom() failed: sender address mismatch" << std::endl;
+        if (counters) {
+            counters->addressMismatched();
+        }
         return false;
     }
 
@@ -75,13 +132,379 @@ bool Unreliable::recv(void *buf, int len) {
     return true;
 }
 
-std::unique_ptr<Packet> Unreliable::recv() {
-    auto packet = reinterpret_cast<Packet *>(new uint8_t[MAX_PACKET_SIZE]{});
-    if (!recv(packet, MAX_PACKET_SIZE) ||
+PacketPtr Unreliable::recv() {
+    auto packet = PacketPool::allocate();
+    if (!recv(packet.get(), MAX_PACKET_SIZE) ||
         packet->len > MAX_PACKET_SIZE ||
         packet->len == 0) {
         return nullptr;
     }
 
-    return std::unique_ptr<Packet>(packet);
-}
\ No newline at end of file
+    return packet;
+}
+
+int Unreliable::recv(std::vector<PacketPtr> &packets, std::chrono::steady_clock::duration timeout,
+                     int maxCount) {
+    timeout = (std::max)(timeout, std::chrono::steady_clock::duration::zero());
+
+    if (!waitReadable(timeout)) {
+        return 0;
+    }
+    return recv(packets, maxCount);
+}
+
+#ifdef _WIN32
+
+bool Unreliable::send(const PacketSlice &slice) {
+    WSABUF bufs[2];
+    bufs[0].buf = (char *) &slice.header;
+    bufs[0].len = sizeof(Packet);
+    bufs[1].buf = (char *) slice.data;
+    bufs[1].len = slice.header.len - sizeof(Packet);
+
+    DWORD sent;
+    int result = WSASendTo(s, bufs, 2, &sent, 0, (sockaddr *) &remoteAddr, sizeof(remoteAddr),
+                           nullptr, nullptr);
+    if (result == SOCKET_ERROR) {
+        LOG_ERROR << "WSASendTo() failed: " << lastSocketError() << std::endl;
+        return false;
+    }
+
+    if (counters) {
+        counters->sent(1, slice.header.len);
+    }
+    return true;
+}
+
+#else
+
+bool Unreliable::send(const PacketSlice &slice) {
+    iovec iovs[2];
+    msghdr msg{};
+    iovs[0].iov_base = const_cast<Packet *>(&slice.header);
+    iovs[0].iov_len = sizeof(Packet);
+    iovs[1].iov_base = const_cast<uint8_t *>(slice.data);
+    iovs[1].iov_len = slice.header.len - sizeof(Packet);
+    msg.msg_name = &remoteAddr;
+    msg.msg_namelen = sizeof(remoteAddr);
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = 2;
+
+    if (sendmsg(s, &msg, 0) == SOCKET_ERROR) {
+        LOG_ERROR << "sendmsg() failed: " << lastSocketError() << std::endl;
+        return false;
+    }
+
+    if (counters) {
+        counters->sent(1, slice.header.len);
+    }
+    return true;
+}
+
+#endif
+
+#ifdef __linux__
+
+bool Unreliable::waitReadable(std::chrono::steady_clock::duration timeout) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+    timespec ts{static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+    pollfd fd{s, POLLIN, 0};
+
+    int result = ppoll(&fd, 1, &ts, nullptr);
+    if (result == SOCKET_ERROR && errno != EINTR) {
+        LOG_ERROR << "ppoll() failed: " << errno << std::endl;
+    }
+    return result > 0;
+}
+
+int Unreliable::send(std::span<const PacketSlice *const> slices) {
+    int count = static_cast<int>(slices.size());
+    int sent = 0;
+
+    while (sent < count) {
+        auto rest = slices.subspan(sent);
+        int result = gso ? sendSegmented(rest) : sendBatch(rest);
+        if (result == SOCKET_ERROR) {
+            break;
+        }
+        sent += result;
+    }
+
+    if (counters) {
+        uint64_t bytes = 0;
+        for (int i = 0; i < sent; i++) {
+            bytes += slices[i]->header.len;
+        }
+        counters->sent(sent, bytes);
+    }
+    return sent;
+}
+
+int Unreliable::sendBatch(std::span<const PacketSlice *const> slices) {
+    int count = (std::min)(static_cast<int>(slices.size()), MAX_BATCH_SIZE);
+
+    iovec iovs[MAX_BATCH_SIZE][2];
+    mmsghdr msgs[MAX_BATCH_SIZE]{};
+    for (int i = 0; i < count; i++) {
+        const PacketSlice *slice = slices[i];
+        iovs[i][0].iov_base = const_cast<Packet *>(&slice->header);
+        iovs[i][0].iov_len = sizeof(Packet);
+        iovs[i][1].iov_base = const_cast<uint8_t *>(slice->data);
+        iovs[i][1].iov_len = slice->header.len - sizeof(Packet);
+        msgs[i].msg_hdr.msg_name = &remoteAddr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(remoteAddr);
+        msgs[i].msg_hdr.msg_iov = iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 2;
+    }
+
+    int result = sendmmsg(s, msgs, count, 0);
+    if (result == SOCKET_ERROR) {
+        LOG_ERROR << "sendmmsg() failed: " << lastSocketError() << std::endl;
+    }
+    return result;
+}
+
+// segments the kernel cuts one datagram into at most (UDP_MAX_SEGMENTS)
+const static int gsoMaxSegments = 64;
+// bytes of one datagram at most, before it is cut
+const static uint32_t gsoMaxBytes = 65507;
+
+int Unreliable::sendSegmented(std::span<const PacketSlice *const> slices) {
+    int count = (std::min)(static_cast<int>(slices.size()), MAX_BATCH_SIZE);
+
+    iovec iovs[MAX_BATCH_SIZE * 2];
+    mmsghdr msgs[MAX_BATCH_SIZE]{};
+    char controls[MAX_BATCH_SIZE][CMSG_SPACE(sizeof(uint16_t))]{};
+    // slices in each message
+    int segments[MAX_BATCH_SIZE];
+    int messages = 0;
+
+    for (int i = 0; i < count;) {
+        // equal sized slices in a row go out as one datagram, which the
+        // kernel cuts back into one per slice, only the last may be shorter
+        int first = i;
+        uint32_t segmentLen = slices[i]->header.len;
+        uint32_t bytes = 0;
+        do {
+            const PacketSlice *slice = slices[i];
+            iovs[2 * i].iov_base = const_cast<Packet *>(&slice->header);
+            iovs[2 * i].iov_len = sizeof(Packet);
+            iovs[2 * i + 1].iov_base = const_cast<uint8_t *>(slice->data);
+            iovs[2 * i + 1].iov_len = slice->header.len - sizeof(Packet);
+            bytes += slice->header.len;
+            i++;
+        } while (i < count &&
+                 i - first < gsoMaxSegments &&
+                 slices[i - 1]->header.len == segmentLen &&
+                 slices[i]->header.len <= segmentLen &&
+                 bytes + slices[i]->header.len <= gsoMaxBytes);
+
+        msghdr &msg = msgs[messages].msg_hdr;
+        msg.msg_name = &remoteAddr;
+        msg.msg_namelen = sizeof(remoteAddr);
+        msg.msg_iov = &iovs[2 * first];
+        msg.msg_iovlen = 2 * (i - first);
+        if (i - first > 1) {
+            msg.msg_control = controls[messages];
+            msg.msg_controllen = sizeof(controls[messages]);
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            auto size = static_cast<uint16_t>(segmentLen);
+            memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+        }
+        segments[messages++] = i - first;
+    }
+
+    int result = sendmmsg(s, msgs, messages, 0);
+    if (result == SOCKET_ERROR) {
+        int error = lastSocketError();
+        // no offload on this path (e.g. a segment above the MTU), send them one by one from now on
+        if (error == EMSGSIZE || error == EIO || error == EINVAL || error == ENOPROTOOPT || error == EOPNOTSUPP) {
+            LOG_WARN << "segmentation offload refused: " << error << ", turned off" << std::endl;
+            gso = false;
+            return 0;
+        }
+        LOG_ERROR << "sendmmsg() failed: " << error << std::endl;
+        return SOCKET_ERROR;
+    }
+
+    int sent = 0;
+    for (int i = 0; i < result; i++) {
+        sent += segments[i];
+    }
+    return sent;
+}
+
+int Unreliable::recv(std::vector<PacketPtr> &packets, int maxCount) {
+    if (!groTried) {
+        groTried = true;
+        int enable = 1;
+        gro = setsockopt(s, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    }
+    if (gro) {
+        return recvCoalesced(packets, maxCount);
+    }
+
+    maxCount = (std::min)(maxCount, MAX_BATCH_SIZE);
+
+    PacketPtr buffers[MAX_BATCH_SIZE];
+    iovec iovs[MAX_BATCH_SIZE];
+    sockaddr_in senderAddrs[MAX_BATCH_SIZE];
+    mmsghdr msgs[MAX_BATCH_SIZE]{};
+    for (int i = 0; i < maxCount; i++) {
+        buffers[i] = PacketPool::allocate();
+        iovs[i].iov_base = buffers[i].get();
+        iovs[i].iov_len = MAX_PACKET_SIZE;
+        msgs[i].msg_hdr.msg_name = &senderAddrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(senderAddrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // block for the first datagram, then take whatever is already queued
+    int result = recvmmsg(s, msgs, maxCount, MSG_WAITFORONE, nullptr);
+    if (result == SOCKET_ERROR) {
+        LOG_ERROR << "recvmmsg() failed: " << lastSocketError() << std::endl;
+        return 0;
+    }
+
+    int appended = 0;
+    for (int i = 0; i < result; i++) {
+        auto &packet = buffers[i];
+        uint32_t received = msgs[i].msg_len;
+        if (!acceptSender(senderAddrs[i]) ||
+            received < sizeof(Packet) ||
+            packet->len != received) {
+            continue;
+        }
+
+        if (counters) {
+            counters->received(1, received);
+        }
+        packets.push_back(std::move(packet));
+        appended++;
+    }
+
+    return appended;
+}
+
+// coalesced datagrams read at once
+const static int groBatchSize = 16;
+// the largest datagram the kernel hands out
+const static uint32_t groBufferSize = 65535;
+
+int Unreliable::recvCoalesced(std::vector<PacketPtr> &packets, int maxCount) {
+    int count = std::clamp(maxCount, 1, groBatchSize);
+
+    // every packet is copied out before returning, so one per thread will do
+    thread_local std::vector<uint8_t> scratch(groBatchSize * groBufferSize);
+
+    iovec iovs[groBatchSize];
+    sockaddr_in senderAddrs[groBatchSize];
+    mmsghdr msgs[groBatchSize]{};
+    char controls[groBatchSize][CMSG_SPACE(sizeof(int))];
+    for (int i = 0; i < count; i++) {
+        iovs[i].iov_base = &scratch[i * groBufferSize];
+        iovs[i].iov_len = groBufferSize;
+        msgs[i].msg_hdr.msg_name = &senderAddrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(senderAddrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = controls[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+    }
+
+    int result = recvmmsg(s, msgs, count, MSG_WAITFORONE, nullptr);
+    if (result == SOCKET_ERROR) {
+        LOG_ERROR << "recvmmsg() failed: " << lastSocketError() << std::endl;
+        return 0;
+    }
+
+    int appended = 0;
+    for (int i = 0; i < result; i++) {
+        msghdr &msg = msgs[i].msg_hdr;
+        if (!acceptSender(senderAddrs[i]) || (msg.msg_flags & MSG_TRUNC)) {
+            continue;
+        }
+
+        // a coalesced datagram says how long its segments are, all but the last
+        uint32_t len = msgs[i].msg_len;
+        uint32_t segmentLen = len;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int size;
+                memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+                segmentLen = size;
+            }
+        }
+        if (segmentLen == 0) {
+            continue;
+        }
+
+        const uint8_t *data = &scratch[i * groBufferSize];
+        for (uint32_t offset = 0; offset < len; offset += segmentLen) {
+            uint32_t received = (std::min)(segmentLen, len - offset);
+            if (received < sizeof(Packet) || received > MAX_PACKET_SIZE) {
+                continue;
+            }
+
+            auto packet = PacketPool::allocate();
+            memcpy(packet.get(), data + offset, received);
+            if (packet->len != received) {
+                continue;
+            }
+            if (counters) {
+                counters->received(1, received);
+            }
+            packets.push_back(std::move(packet));
+            appended++;
+        }
+    }
+
+    return appended;
+}
+
+#else
+
+// one datagram a call, on windows and the other BSD socket platforms
+bool Unreliable::waitReadable(std::chrono::steady_clock::duration timeout) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(timeout).count();
+    timeval tv{};
+    tv.tv_sec = static_cast<decltype(tv.tv_sec)>(us / 1000000);
+    tv.tv_usec = static_cast<decltype(tv.tv_usec)>(us % 1000000);
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(s, &readable);
+
+    int result = select(static_cast<int>(s) + 1, &readable, nullptr, nullptr, &tv);
+    if (result == SOCKET_ERROR) {
+        LOG_ERROR << "select() failed: " << lastSocketError() << std::endl;
+    }
+    return result > 0;
+}
+
+int Unreliable::send(std::span<const PacketSlice *const> slices) {
+    int sent = 0;
+    for (const PacketSlice *slice: slices) {
+        if (!send(*slice)) {
+            break;
+        }
+        sent++;
+    }
+    return sent;
+}
+
+int Unreliable::recv(std::vector<PacketPtr> &packets, int) {
+
+    auto packet = recv();
+    if (packet == nullptr) {
+        return 0;
+    }
+
+    packets.push_back(std::move(packet));
+    return 1;
+}
+
+#endif
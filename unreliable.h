@@ -4,17 +4,40 @@
 #include <string>
 #include <memory>
 #include <cstddef>
-#include <winsock2.h>
+#include <span>
+#include <chrono>
+#include <vector>
+#include "platform.h"
 #include "packet.h"
+#include "transport.h"
 
-class Unreliable {
+// max number of datagrams moved by one batched send / recv call
+#define MAX_BATCH_SIZE (64)
+
+class Unreliable : public ITransport {
     SOCKET s;
     sockaddr_in remoteAddr{};
+    // false when the socket is shared, somebody else reads and closes it
+    bool owned = true;
+    // as agreed in the handshake
+    uint32_t maxPacketSize = MAX_PACKET_SIZE;
+    // what goes through the socket is counted here, if anywhere
+    ConnectionStats *counters = nullptr;
+#ifdef __linux__
+    // segmentation offload (UDP_SEGMENT), off for good once the kernel refuses it
+    bool gso = true;
+    // receive offload (UDP_GRO), turned on by the first batched recv
+    bool gro = false;
+    bool groTried = false;
+#endif
 public:
     Unreliable(SOCKET s, const std::string &ip, uint16_t port);
 
     Unreliable(SOCKET s);
 
+    // one peer on a socket somebody else owns, only for sending
+    Unreliable(SOCKET s, const sockaddr_in &remoteAddr, bool owned);
+
     ~Unreliable();
 
     Unreliable(const Unreliable &) = delete;
@@ -25,13 +48,69 @@ public:
 
     Unreliable &operator=(Unreliable &&obj);
 
+    SOCKET socket() const {
+        return s;
+    }
+
+    uint32_t packetSize() const override {
+        return maxPacketSize;
+    }
+
+    void setPacketSize(uint32_t size) {
+        maxPacketSize = size;
+    }
+
+    ConnectionStats *stats() const override {
+        return counters;
+    }
+
+    // count datagrams, bytes and strangers, the sessions count the rest
+    void setStats(ConnectionStats *stats) {
+        counters = stats;
+    }
+
     bool send(void *buf, int len);
 
-    bool send(const std::unique_ptr<Packet> &packet);
+    bool send(const PacketPtr &packet) override;
 
     bool recv(void *buf, int len);
 
-    std::unique_ptr<Packet> recv();
+    PacketPtr recv();
+
+    // scatter/gather send, the payload is not copied
+    bool send(const PacketSlice &slice) override;
+
+    // send all slices, with as few syscalls as possible (sendmmsg on linux,
+    // with equal sized slices in a row sent as one segmented datagram),
+    // returns the number of slices sent
+    int send(std::span<const PacketSlice *const> slices) override;
+
+    // block until at least one packet arrives, then drain up to maxCount
+    // datagrams which are already queued (recvmmsg on linux), valid packets
+    // are appended to packets, returns the number appended, which may be
+    // more than maxCount when the kernel coalesced datagrams (UDP_GRO)
+    int recv(std::vector<PacketPtr> &packets, int maxCount = MAX_BATCH_SIZE);
+
+    // the same, but give up after timeout, returns 0 if nothing arrived
+    int recv(std::vector<PacketPtr> &packets, std::chrono::steady_clock::duration timeout,
+             int maxCount = MAX_BATCH_SIZE);
+
+private:
+    bool acceptSender(const sockaddr_in &senderAddr);
+
+    // wait up to timeout for the socket to become readable
+    bool waitReadable(std::chrono::steady_clock::duration timeout);
+
+#ifdef __linux__
+    // one sendmmsg of up to MAX_BATCH_SIZE slices, -1 on error
+    int sendBatch(std::span<const PacketSlice *const> slices);
+
+    // the same with segmentation offload, 0 when the kernel refused it
+    int sendSegmented(std::span<const PacketSlice *const> slices);
+
+    // recv when datagrams may be coalesced, they are split into packets again
+    int recvCoalesced(std::vector<PacketPtr> &packets, int maxCount);
+#endif
 };
 
 #endif //RELIABLE_OVER_UDP_UNRELIABLE_H